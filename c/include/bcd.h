@@ -1,8 +1,12 @@
+#ifndef BCD_H
+#define BCD_H
+
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 #include "macros.h"
+#include "math.h"
 
 #if !PCC_COMPILER
     #include <stdlib.h>
@@ -11,36 +15,258 @@
     #include "math.h"
 #endif
 
+#if HAS_X64_SIMD
+    #include <immintrin.h>
+#endif
+
+// allocator section
+// every digit buffer and scratch array in this file goes through the current bcd_allocator, which defaults to the
+// C library. set_bcd_allocator() swaps it out, so a whole computation can run inside a bcd_arena and be thrown away
+// at once. A BCD_int must be freed under the same allocator that created it
+
+typedef struct bcd_allocator bcd_allocator;
+struct bcd_allocator    {
+    void *(*alloc)(void *state, size_t size);
+    void *(*resize)(void *state, void *ptr, size_t old_size, size_t new_size);
+    void (*release)(void *state, void *ptr, size_t size);
+    void *state;
+};
+
+void *bcd_libc_alloc(void *state, size_t size)  {
+    return malloc(size);
+}
+
+void *bcd_libc_resize(void *state, void *ptr, size_t old_size, size_t new_size)   {
+    return realloc(ptr, new_size);
+}
+
+void bcd_libc_release(void *state, void *ptr, size_t size)  {
+    free(ptr);
+}
+
+static bcd_allocator bcd_libc_allocator = {bcd_libc_alloc, bcd_libc_resize, bcd_libc_release, NULL};
+static bcd_allocator *bcd_current_allocator = &bcd_libc_allocator;
+
+bcd_allocator *set_bcd_allocator(bcd_allocator *allocator)  {
+    // installs allocator, or the C library if it is NULL, and returns the previous one so it can be put back
+    bcd_allocator *previous = bcd_current_allocator;
+    bcd_current_allocator = (allocator == NULL) ? &bcd_libc_allocator : allocator;
+    return previous;
+}
+
+void *bcd_alloc(size_t size);
+inline void *bcd_alloc(size_t size) {
+    return bcd_current_allocator->alloc(bcd_current_allocator->state, size);
+}
+
+void *bcd_resize(void *ptr, size_t old_size, size_t new_size);
+inline void *bcd_resize(void *ptr, size_t old_size, size_t new_size)    {
+    return bcd_current_allocator->resize(bcd_current_allocator->state, ptr, old_size, new_size);
+}
+
+void bcd_release(void *ptr, size_t size);
+inline void bcd_release(void *ptr, size_t size) {
+    bcd_current_allocator->release(bcd_current_allocator->state, ptr, size);
+}
+
+// a bcd_arena hands out memory by bumping a pointer through large chunks. Blocks are rounded up to a power of two,
+// and released blocks go onto a free list for their size, so the short-lived temporaries of a loop keep being reused
+// rather than piling up. bcd_arena_mark() and bcd_arena_reset() pop everything allocated after the mark in O(chunks)
+// time, and free_bcd_arena() gives all of it back to the C library
+
+#ifndef BCD_ARENA_MIN_BLOCK
+    #define BCD_ARENA_MIN_BLOCK 16  // must be a power of two that can hold a pointer
+#endif
+#ifndef BCD_ARENA_CHUNK_SIZE
+    #define BCD_ARENA_CHUNK_SIZE 65536
+#endif
+#define BCD_ARENA_CLASSES (sizeof(size_t) * 8)
+
+typedef struct bcd_arena_chunk bcd_arena_chunk;
+struct bcd_arena_chunk  {
+    bcd_arena_chunk *prev;
+    size_t size;
+    size_t used;
+    size_t padding;  // keeps the data after the header aligned to 16 bytes on 64-bit targets
+};
+
+typedef struct bcd_arena bcd_arena;
+struct bcd_arena    {
+    bcd_arena_chunk *top;
+    size_t chunk_size;
+    void *free_lists[BCD_ARENA_CLASSES];
+};
+
+typedef struct {
+    bcd_arena_chunk *top;
+    size_t used;
+} bcd_arena_marker;
+
+bcd_arena new_bcd_arena(size_t chunk_size)  {
+    // chunk_size is how many bytes to grab from the C library at a time. 0 uses BCD_ARENA_CHUNK_SIZE
+    bcd_arena ret;
+    ret.top = NULL;
+    ret.chunk_size = chunk_size ? chunk_size : BCD_ARENA_CHUNK_SIZE;
+    memset(ret.free_lists, 0, sizeof(ret.free_lists));
+    return ret;
+}
+
+unsigned char bcd_arena_class(size_t size)  {
+    // blocks in class k are BCD_ARENA_MIN_BLOCK << k bytes
+    unsigned char k = 0;
+    for (size_t block = BCD_ARENA_MIN_BLOCK; block < size; block <<= 1)  {
+        k++;
+    }
+    return k;
+}
+
+void *bcd_arena_alloc(void *state, size_t size) {
+    if (unlikely(!size))    {
+        return NULL;
+    }
+    bcd_arena *arena = (bcd_arena *) state;
+    unsigned char k = bcd_arena_class(size);
+    size_t block = (size_t) BCD_ARENA_MIN_BLOCK << k;
+    void *ret = arena->free_lists[k];
+    if (ret != NULL)    {
+        arena->free_lists[k] = *(void **) ret;
+        return ret;
+    }
+    if (arena->top == NULL || arena->top->size - arena->top->used < block)  {
+        size_t chunk_size = max(arena->chunk_size, block);
+        bcd_arena_chunk *chunk = (bcd_arena_chunk *) malloc(sizeof(bcd_arena_chunk) + chunk_size);
+        chunk->prev = arena->top;
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        arena->top = chunk;
+    }
+    ret = (unsigned char *) (arena->top + 1) + arena->top->used;
+    arena->top->used += block;
+    return ret;
+}
+
+void bcd_arena_release(void *state, void *ptr, size_t size) {
+    if (ptr == NULL)    {
+        return;
+    }
+    bcd_arena *arena = (bcd_arena *) state;
+    unsigned char k = bcd_arena_class(size);
+    *(void **) ptr = arena->free_lists[k];
+    arena->free_lists[k] = ptr;
+}
+
+void *bcd_arena_resize(void *state, void *ptr, size_t old_size, size_t new_size)  {
+    if (ptr == NULL)    {
+        return bcd_arena_alloc(state, new_size);
+    }
+    bcd_arena *arena = (bcd_arena *) state;
+    unsigned char old_k = bcd_arena_class(old_size), new_k = bcd_arena_class(new_size);
+    if (new_k <= old_k) {
+        return ptr;
+    }
+    size_t old_block = (size_t) BCD_ARENA_MIN_BLOCK << old_k, new_block = (size_t) BCD_ARENA_MIN_BLOCK << new_k;
+    bcd_arena_chunk *top = arena->top;
+    unsigned char *data = (unsigned char *) (top + 1);
+    if ((unsigned char *) ptr + old_block == data + top->used && top->size - top->used >= new_block - old_block)  {
+        // this was the last block handed out, so it can just grow into the rest of the chunk
+        top->used += new_block - old_block;
+        return ptr;
+    }
+    void *ret = bcd_arena_alloc(state, new_size);
+    memcpy(ret, ptr, old_size);
+    bcd_arena_release(state, ptr, old_size);
+    return ret;
+}
+
+bcd_allocator bcd_arena_allocator(bcd_arena *arena);
+inline bcd_allocator bcd_arena_allocator(bcd_arena *arena)  {
+    // arena must stay put for as long as the returned allocator is in use
+    bcd_allocator ret = {bcd_arena_alloc, bcd_arena_resize, bcd_arena_release, (void *) arena};
+    return ret;
+}
+
+bcd_arena_marker bcd_arena_mark(const bcd_arena *arena);
+inline bcd_arena_marker bcd_arena_mark(const bcd_arena *arena)  {
+    bcd_arena_marker ret = {arena->top, arena->top ? arena->top->used : 0};
+    return ret;
+}
+
+void bcd_arena_reset(bcd_arena *arena, bcd_arena_marker marker)    {
+    // frees everything allocated since marker was taken. Blocks released before that point are forgotten as well,
+    // since the free lists can't tell which side of the marker they came from
+    while (arena->top != marker.top)    {
+        bcd_arena_chunk *prev = arena->top->prev;
+        free(arena->top);
+        arena->top = prev;
+    }
+    if (arena->top != NULL) {
+        arena->top->used = marker.used;
+    }
+    memset(arena->free_lists, 0, sizeof(arena->free_lists));
+}
+
+void free_bcd_arena(bcd_arena *arena);
+inline void free_bcd_arena(bcd_arena *arena)    {
+    bcd_arena_marker empty = {NULL, 0};
+    bcd_arena_reset(arena, empty);
+}
+
 typedef unsigned char packed_BCD_pair;
+
+#ifndef BCD_SMALL_BYTES
+    // numbers with up to twice this many digits are stored inside the BCD_int itself
+    #define BCD_SMALL_BYTES 8
+#endif
+
 typedef struct {
     // a little-endian, arbitrary-precision, binary-coded decimal number
-    packed_BCD_pair *digits;
+    // small numbers keep their digits inside the struct, so they never touch the heap, and copying the struct copies
+    // them too. Which member of digits is live depends on capacity, so always go through bcd_data()
+    union   {
+        packed_BCD_pair *heap;
+        packed_BCD_pair small[BCD_SMALL_BYTES];
+    } digits;
     size_t bcd_digits;
     size_t decimal_digits;
+    size_t capacity;  // how many bytes digits has room for. At most BCD_SMALL_BYTES means digits.small is in use
     bool negative : 1;
     bool zero : 1;
 } BCD_int;
 
+packed_BCD_pair *bcd_data(BCD_int *x);
+inline packed_BCD_pair *bcd_data(BCD_int *x)    {
+    // returns the packed bytes of x, wherever they live
+    return (x->capacity <= BCD_SMALL_BYTES) ? x->digits.small : x->digits.heap;
+}
+
+packed_BCD_pair *bcd_init_digits(BCD_int *x, size_t bytes);
+inline packed_BCD_pair *bcd_init_digits(BCD_int *x, size_t bytes)  {
+    // gives a new x room for bytes packed bytes, inside the struct if they fit, and returns them
+    if (bytes <= BCD_SMALL_BYTES)   {
+        x->capacity = BCD_SMALL_BYTES;
+        return x->digits.small;
+    }
+    x->capacity = bytes;
+    return x->digits.heap = (packed_BCD_pair *) bcd_alloc(sizeof(packed_BCD_pair) * bytes);
+}
+
 void free_BCD_int(BCD_int x);
 inline void free_BCD_int(BCD_int x) {
-    free(x.digits);
-    x.digits = NULL;
-    x.bcd_digits = x.decimal_digits = x.negative = x.zero = 0;
+    if (x.capacity > BCD_SMALL_BYTES)   {
+        bcd_release(x.digits.heap, x.capacity);
+    }
 }
 
 BCD_int new_BCD_int(uintmax_t a, bool negative)   {
+    // this sizes the result exactly, and numbers of up to 2 * BCD_SMALL_BYTES digits don't allocate at all
     BCD_int c;
-    #if !PCC_COMPILER
-        c.decimal_digits = ceil(log10(a + 1));
-    #else
-        c.decimal_digits = imprecise_log10(a + 1);
-    #endif
+    c.decimal_digits = count_digits(a);
     c.bcd_digits = (c.decimal_digits + 1) / 2;
-    c.digits = (packed_BCD_pair *) malloc(sizeof(packed_BCD_pair) * c.bcd_digits);
+    packed_BCD_pair *digits = bcd_init_digits(&c, c.bcd_digits);
     c.negative = negative;
     c.zero = !a;
     for (size_t i = 0; i < c.bcd_digits; i++)   {
-        c.digits[i] = (((a % 100) / 10) << 4) | (a % 10);
+        digits[i] = (((a % 100) / 10) << 4) | (a % 10);
         a /= 100;
     }
     return c;
@@ -48,100 +274,148 @@ BCD_int new_BCD_int(uintmax_t a, bool negative)   {
 
 BCD_int copy_BCD_int(BCD_int a);
 inline BCD_int copy_BCD_int(BCD_int a)  {
+    if (a.capacity <= BCD_SMALL_BYTES)  {
+        return a;
+    }
     BCD_int b = a;
-    b.digits = (packed_BCD_pair *) malloc(sizeof(packed_BCD_pair) * b.bcd_digits);
-    memcpy(b.digits, a.digits, b.bcd_digits);
+    memcpy(bcd_init_digits(&b, a.bcd_digits), a.digits.heap, a.bcd_digits);
     return b;
 }
 
 BCD_int BCD_from_bytes(const unsigned char *str, size_t chars, bool negative, bool little_endian)   {
-    // converts a bytestring to a little-endian BCD int
+    // converts a bytestring to a little-endian BCD int. Leading zero bytes are dropped before allocating
     BCD_int c;
-    if (!chars || str == NULL)  {
-        c.zero = true;
-        c.bcd_digits = c.decimal_digits = c.negative = 0;
-        c.digits = NULL;
-        return c;
+    size_t i, len = (str == NULL) ? 0 : chars;
+    if (little_endian)  {
+        for (; len && !str[len - 1]; len--);
     }
-    size_t i;
+    else    {
+        for (; len && !str[chars - len]; len--);
+    }
+    if (!len)   {
+        return new_BCD_int(0, false);
+    }
+    packed_BCD_pair *digits = bcd_init_digits(&c, len);
     c.zero = false;
     c.negative = negative;
-    c.digits = (packed_BCD_pair *) malloc(sizeof(packed_BCD_pair) * chars);
+    c.bcd_digits = len;
     if (little_endian)  {
-        for (i = 0; i < chars; i++) {
-            c.digits[i] = str[i];
-        }
+        memcpy(digits, str, len);
     }
     else    {
-        size_t j;
-        for (i = 0, j = chars - 1; i < chars; i++, j--) {
-            c.digits[i] = str[j];
+        for (i = 0; i < len; i++)   {
+            digits[i] = str[chars - 1 - i];
         }
     }
-    for (i = chars - 1; i != -1; i--)   {
-        if (c.digits[i] & 0xF0) {
-            c.decimal_digits = i * 2 + 1;
-            c.bcd_digits = i + 1;
-            break;
-        }
-        if (c.digits[i] & 0x0F) {
-            c.decimal_digits = i * 2;
-            c.bcd_digits = i + 1;
-            break;
+    c.decimal_digits = len * 2 - !(digits[len - 1] & 0xF0);
+    return c;
+}
+
+// ASCII conversion section
+// digits go straight between text and the packed buffer, 16 characters (8 bytes) at a time where SSE2 is around.
+// Each pair of characters is one packed byte, but text is big-endian and BCD_int is little-endian, so every group
+// of 8 bytes gets its order flipped on the way through
+
+void bcd_pack_ascii(packed_BCD_pair *out, const char *str, size_t n)  {
+    // packs the n ASCII digits at str into (n + 1) / 2 little-endian bytes at out
+    size_t i = 0;
+    #if HAS_X64_SIMD
+        const __m128i zeros = _mm_set1_epi8('0'), low_byte = _mm_set1_epi16(0x00FF);
+        for (; i + 16 <= n; i += 16)    {
+            // each 16-bit lane holds a high digit in its low byte and a low digit in its high byte
+            __m128i v = _mm_sub_epi8(_mm_loadu_si128((const __m128i *) (str + n - i - 16)), zeros);
+            v = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(v, 4), _mm_srli_epi16(v, 8)), low_byte);
+            uint64_t packed = __builtin_bswap64((uint64_t) _mm_cvtsi128_si64(_mm_packus_epi16(v, v)));
+            memcpy(out + i / 2, &packed, sizeof(packed));
         }
+    #endif
+    for (; i + 2 <= n; i += 2)  {
+        out[i / 2] = ((str[n - i - 2] - '0') << 4) | ((str[n - i - 1] - '0') & 0xF);
     }
-    if (unlikely(i == -1))  {
-        c.zero = true;
-        c.bcd_digits = c.decimal_digits = c.negative = 0;
-        free(c.digits);
-        c.digits = NULL;
+    if (i < n)  {
+        out[i / 2] = str[0] - '0';
     }
-    return c;
 }
 
-BCD_int BCD_from_ascii(const char *str, size_t digits, bool negative);
-inline BCD_int BCD_from_ascii(const char *str, size_t digits, bool negative)    {
-    // packs an ASCII digit string into big-endian bytes, then runs through BCD_from_bytes()
-    size_t length = (digits + 1) / 2, i, j;
-    unsigned char *bytes = (unsigned char *) malloc(sizeof(unsigned char) * length);
-    j = i = digits % 2;
-    if (i)  {
-        bytes[0] = str[0] - '0';
+void bcd_unpack_ascii(char *out, const packed_BCD_pair *digits, size_t n) {
+    // writes the n little-endian bytes at digits as 2 * n ASCII digits at out, top byte first
+    size_t i = 0;
+    #if HAS_X64_SIMD
+        const __m128i zeros = _mm_set1_epi8('0'), low_nibble = _mm_set1_epi8(0x0F);
+        for (; i + 8 <= n; i += 8)  {
+            uint64_t packed;
+            memcpy(&packed, digits + n - i - 8, sizeof(packed));
+            __m128i v = _mm_cvtsi64_si128((long long) __builtin_bswap64(packed));
+            __m128i high = _mm_and_si128(_mm_srli_epi16(v, 4), low_nibble), low = _mm_and_si128(v, low_nibble);
+            _mm_storeu_si128((__m128i *) (out + 2 * i), _mm_add_epi8(_mm_unpacklo_epi8(high, low), zeros));
+        }
+    #endif
+    for (; i < n; i++)  {
+        out[2 * i] = '0' + (digits[n - i - 1] >> 4);
+        out[2 * i + 1] = '0' + (digits[n - i - 1] & 0xF);
     }
-    for (; i < length; i++, j += 2) {
-        bytes[i] = ((str[j] - '0') << 4) | ((str[j + 1] - '0') & 0xF);
+}
+
+BCD_int BCD_from_ascii(const char *str, size_t digits, bool negative)   {
+    // parses digits ASCII characters at str, with no sign, straight into a new BCD_int. Leading zeros are skipped
+    BCD_int ret;
+    for (; digits && *str == '0'; str++, digits--);
+    if (unlikely(!digits))  {
+        return new_BCD_int(0, false);
     }
-    BCD_int ret = BCD_from_bytes(bytes, length, negative, false);
-    free(bytes);
+    ret.zero = false;
+    ret.negative = negative;
+    ret.decimal_digits = digits;
+    ret.bcd_digits = (digits + 1) / 2;
+    bcd_init_digits(&ret, ret.bcd_digits);
+    bcd_pack_ascii(bcd_data(&ret), str, digits);
     return ret;
 }
 
-BCD_int sub_bcd(BCD_int x, BCD_int y);
-
-BCD_int add_bcd(BCD_int x, BCD_int y)   {
-    // performing this on two n-digit numbers will take O(n) time
+size_t bcd_to_chars(BCD_int x, char *buf)   {
+    // writes x into buf as a NUL-terminated decimal string and returns its length without the NUL
+    // buf needs room for x.decimal_digits + 2 characters
+    size_t len = 0;
     if (unlikely(x.zero))   {
-        return copy_BCD_int(y);
+        buf[len++] = '0';
     }
-    if (unlikely(y.zero))   {
-        return copy_BCD_int(x);
-    }
-    if (x.negative != y.negative)   {
-        // if signs don't match, absolute value would go down.
-        // that means we need to flip y's sign and move through sub_bcd()
-        y.negative = !y.negative;
-        return sub_bcd(x, y);
+    else    {
+        if (x.negative) {
+            buf[len++] = '-';
+        }
+        if (x.decimal_digits % 2)   {
+            buf[len++] = '0' + bcd_data(&x)[x.bcd_digits - 1];
+        }
+        bcd_unpack_ascii(buf + len, bcd_data(&x), x.decimal_digits / 2);
+        len += x.decimal_digits - x.decimal_digits % 2;
     }
-    BCD_int z;
-    size_t i, min_digits = min(x.bcd_digits, y.bcd_digits), max_digits = max(x.bcd_digits, y.bcd_digits);
-    z.zero = false;  // result can't be zero because x and y are non-zero and share a sign
-    z.negative = x.negative;  // we know this is also y.negative
-    z.digits = (packed_BCD_pair *) malloc(sizeof(packed_BCD_pair) * (max_digits + 1));
+    buf[len] = 0;
+    return len;
+}
+
+#if HAS_INT128
+BCD_int BCD_from_uint128(unsigned __int128 a, bool negative)   {
+    // works in chunks of 18 digits, so that most of the division happens on 64-bit halves
+    packed_BCD_pair bytes[27];
+    size_t len = 0;
+    do  {
+        uint64_t chunk = (uint64_t) (a % 1000000000000000000ULL);
+        a /= 1000000000000000000ULL;
+        for (size_t i = 0; i < 9; i++, chunk /= 100)   {
+            bytes[len++] = (((chunk % 100) / 10) << 4) | (chunk % 10);
+        }
+    } while (a);
+    return BCD_from_bytes(bytes, len, negative, true);
+}
+#endif
+
+bool add_bcd_bytes_scalar(packed_BCD_pair *z, const packed_BCD_pair *x, const packed_BCD_pair *y, size_t n, bool overflow)  {
+    // adds n packed bytes of x and y into z, one at a time, and returns the carry out of the top byte
+    // this is the reference that the vectorized kernels are checked against
     packed_BCD_pair a, b, c;
-    bool overflow = false;
-    for (i = 0; i < min_digits; i++) {
-        a = x.digits[i];
-        b = y.digits[i];
+    for (size_t i = 0; i < n; i++) {
+        a = x[i];
+        b = y[i];
         if (!(overflow || a))   {
             c = b;
             overflow = false;
@@ -192,30 +466,289 @@ BCD_int add_bcd(BCD_int x, BCD_int y)   {
                 }
             #endif
             }
-        z.digits[i] = c;
+        z[i] = c;
     }
-    if (x.bcd_digits < y.bcd_digits)    {
-        x = y;
+    return overflow;
+}
+
+bool sub_bcd_bytes_scalar(packed_BCD_pair *z, const packed_BCD_pair *x, const packed_BCD_pair *y, size_t n, bool carry)  {
+    // subtracts n packed bytes of y from x into z, one at a time, and returns the borrow out of the top byte
+    // this is the reference that the vectorized kernels are checked against
+    packed_BCD_pair a, b, c;
+    for (size_t i = 0; i < n; i++) {
+        a = x[i];
+        b = y[i];
+        if (!(carry || b))  {
+            c = a;
+            carry = false;
+        }
+        else    {
+            b += carry;  // incorporate carry from last pair
+            #if (!defined(NO_ASSEMBLY) && X86_COMPILER)
+                // if on these architectures, there's assembly tricks to adjust BCD in-silicon
+                #if CL_COMPILER
+                    // CL compiler has a different syntax for inline assembly, does a lot less lifting
+                    // note that the syntax here is: op [dest [, src]]
+                    // brackets indicate a C symbol is referenced rather than a register
+                    __asm   {
+                        mov al, [a];         // move C symbol a to register al
+                        sub al, [b];         // add C symbol b to register al
+                        das;                 // have the CPU make sure register al contains valid, packed BCD digits
+                        setc [carry];        // set C symbol carry to contain the carry bit, set by daa
+                        mov [c], al;         // move register al to C symbol c
+                    }
+                #else
+                    // this is the standard GCC/LLVM syntax for it
+                    // note that the syntax here is: op [[src, ] dest]
+                    // %\d indicates a C symbol is referenced, see the lookups at the end of code for which
+                    __asm__(
+                        "sub %3, %%al;"    // add the register containing b to al
+                        "das;"             // have the CPU make sure register al contains valid, packed BCD digits
+                        "setc %1;"         // set the register containing carry to hold the carry bit, set by daa
+                                           // this next section tells the compiler what to do after execution
+                      : "=a" (c),          // store the contents of register al in symbol c
+                        "=rgm" (carry)     // and a general register or memory location gets assigned to symbol carry (referenced as %1)
+                                           // then below tells the compiler what our inputs are
+                      : "a" (a),           // symbol a should get dumped to register al
+                        "rgm" (b)          // and symbol b in a general register or memory location (referenced as %3)
+                    );
+                #endif
+            #else
+                // otherwise fall back to doing it in C
+                // unpack both pairs to binary, which also handles b being 0x9A after incorporating carry
+                signed char d = ((a >> 4) * 10 + (a & 0xF)) - ((b >> 4) * 10 + (b & 0xF));
+                if ((carry = (d < 0)))  {   // if the difference dipped below zero, borrow from the next pair
+                    d += 100;
+                }
+                c = ((d / 10) << 4) | (d % 10);
+            #endif
+            }
+        z[i] = c;
+    }
+    return carry;
+}
+
+#if HAS_X64_SIMD
+// the vectorized kernels unpack each byte to binary (0 thru 99), add or subtract whole vectors at once, then work
+// out every byte's carry in one step. A byte generates a carry if its sum passed 99, and propagates one if it is
+// exactly 99, which is the same shape as binary addition. So with G and P as bitmasks, the carries into each byte
+// are the carries of the integer sum G + (G | P) + carry_in, which are (G + (G | P) + carry_in) ^ G ^ (G | P)
+
+__m128i bcd_expand_mask_sse2(uint16_t mask)  {
+    // turns bit i of mask into 0x01 in byte i
+    const __m128i bits = _mm_set1_epi64x(0x8040201008040201ULL);
+    __m128i spread = _mm_set_epi64x(0x0101010101010101ULL * (mask >> 8), 0x0101010101010101ULL * (mask & 0xFF));
+    return _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(spread, bits), bits), _mm_set1_epi8(1));
+}
+
+__m128i bcd_unpack_sse2(__m128i v)   {
+    // 16 * high + low - 6 * high = 10 * high + low
+    __m128i high = _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F));
+    __m128i high_2 = _mm_add_epi8(high, high);
+    return _mm_sub_epi8(v, _mm_add_epi8(high_2, _mm_add_epi8(high_2, high_2)));
+}
+
+__m128i bcd_pack_sse2(__m128i v)    {
+    // v / 10 is (v * 205) >> 11 for every v under 1029, which needs 16-bit lanes, so even and odd bytes go separately
+    const __m128i magic = _mm_set1_epi16(205), low_byte = _mm_set1_epi16(0x00FF);
+    __m128i even = _mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(v, low_byte), magic), 11);
+    __m128i odd = _mm_srli_epi16(_mm_mullo_epi16(_mm_srli_epi16(v, 8), magic), 11);
+    __m128i tens = _mm_or_si128(even, _mm_slli_epi16(odd, 8));
+    __m128i tens_2 = _mm_add_epi8(tens, tens);
+    return _mm_add_epi8(v, _mm_add_epi8(tens_2, _mm_add_epi8(tens_2, tens_2)));
+}
+
+bool add_bcd_bytes_sse2(packed_BCD_pair *z, const packed_BCD_pair *x, const packed_BCD_pair *y, size_t n, bool carry)    {
+    // adds 16 packed bytes (32 digits) at a time. n must be a multiple of 16
+    const __m128i hundred = _mm_set1_epi8(100), ninety_nine = _mm_set1_epi8(99);
+    for (size_t i = 0; i < n; i += 16)  {
+        __m128i a = bcd_unpack_sse2(_mm_loadu_si128((const __m128i *) (x + i)));
+        __m128i b = bcd_unpack_sse2(_mm_loadu_si128((const __m128i *) (y + i)));
+        __m128i sum = _mm_add_epi8(a, b);
+        uint32_t generate = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(sum, hundred), sum));
+        uint32_t propagate = generate | _mm_movemask_epi8(_mm_cmpeq_epi8(sum, ninety_nine));
+        uint32_t carries = generate + propagate + carry;
+        carry = carries >> 16;
+        sum = _mm_add_epi8(sum, bcd_expand_mask_sse2((carries ^ generate ^ propagate) & 0xFFFF));
+        __m128i wrapped = _mm_cmpeq_epi8(_mm_max_epu8(sum, hundred), sum);
+        sum = _mm_sub_epi8(sum, _mm_and_si128(wrapped, hundred));
+        _mm_storeu_si128((__m128i *) (z + i), bcd_pack_sse2(sum));
+    }
+    return carry;
+}
+
+bool sub_bcd_bytes_sse2(packed_BCD_pair *z, const packed_BCD_pair *x, const packed_BCD_pair *y, size_t n, bool carry)    {
+    // subtracts 16 packed bytes (32 digits) at a time. n must be a multiple of 16
+    // here a byte generates a borrow if its difference is negative, and propagates one if it is exactly 0
+    const __m128i hundred = _mm_set1_epi8(100), zero = _mm_setzero_si128();
+    for (size_t i = 0; i < n; i += 16)  {
+        __m128i a = bcd_unpack_sse2(_mm_loadu_si128((const __m128i *) (x + i)));
+        __m128i b = bcd_unpack_sse2(_mm_loadu_si128((const __m128i *) (y + i)));
+        __m128i diff = _mm_sub_epi8(a, b);
+        uint32_t generate = _mm_movemask_epi8(_mm_cmpgt_epi8(zero, diff));
+        uint32_t propagate = generate | _mm_movemask_epi8(_mm_cmpeq_epi8(diff, zero));
+        uint32_t borrows = generate + propagate + carry;
+        carry = borrows >> 16;
+        diff = _mm_sub_epi8(diff, bcd_expand_mask_sse2((borrows ^ generate ^ propagate) & 0xFFFF));
+        diff = _mm_add_epi8(diff, _mm_and_si128(_mm_cmpgt_epi8(zero, diff), hundred));
+        _mm_storeu_si128((__m128i *) (z + i), bcd_pack_sse2(diff));
+    }
+    return carry;
+}
+
+__attribute__((target("avx2"))) __m256i bcd_expand_mask_avx2(uint32_t mask) {
+    const __m256i bits = _mm256_set1_epi64x(0x8040201008040201ULL);
+    const uint64_t spread_byte = 0x0101010101010101ULL;
+    __m256i spread = _mm256_set_epi64x(
+        spread_byte * (mask >> 24), spread_byte * ((mask >> 16) & 0xFF),
+        spread_byte * ((mask >> 8) & 0xFF), spread_byte * (mask & 0xFF)
+    );
+    return _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(spread, bits), bits), _mm256_set1_epi8(1));
+}
+
+__attribute__((target("avx2"))) __m256i bcd_unpack_avx2(__m256i v)  {
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+    __m256i high_2 = _mm256_add_epi8(high, high);
+    return _mm256_sub_epi8(v, _mm256_add_epi8(high_2, _mm256_add_epi8(high_2, high_2)));
+}
+
+__attribute__((target("avx2"))) __m256i bcd_pack_avx2(__m256i v)    {
+    const __m256i magic = _mm256_set1_epi16(205), low_byte = _mm256_set1_epi16(0x00FF);
+    __m256i even = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_and_si256(v, low_byte), magic), 11);
+    __m256i odd = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_srli_epi16(v, 8), magic), 11);
+    __m256i tens = _mm256_or_si256(even, _mm256_slli_epi16(odd, 8));
+    __m256i tens_2 = _mm256_add_epi8(tens, tens);
+    return _mm256_add_epi8(v, _mm256_add_epi8(tens_2, _mm256_add_epi8(tens_2, tens_2)));
+}
+
+__attribute__((target("avx2")))
+bool add_bcd_bytes_avx2(packed_BCD_pair *z, const packed_BCD_pair *x, const packed_BCD_pair *y, size_t n, bool carry)    {
+    // adds 32 packed bytes (64 digits) at a time. n must be a multiple of 32
+    const __m256i hundred = _mm256_set1_epi8(100), ninety_nine = _mm256_set1_epi8(99);
+    for (size_t i = 0; i < n; i += 32)  {
+        __m256i a = bcd_unpack_avx2(_mm256_loadu_si256((const __m256i *) (x + i)));
+        __m256i b = bcd_unpack_avx2(_mm256_loadu_si256((const __m256i *) (y + i)));
+        __m256i sum = _mm256_add_epi8(a, b);
+        uint64_t generate = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(sum, hundred), sum));
+        uint64_t propagate = generate | (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(sum, ninety_nine));
+        uint64_t carries = generate + propagate + carry;
+        carry = carries >> 32;
+        sum = _mm256_add_epi8(sum, bcd_expand_mask_avx2((uint32_t) (carries ^ generate ^ propagate)));
+        __m256i wrapped = _mm256_cmpeq_epi8(_mm256_max_epu8(sum, hundred), sum);
+        sum = _mm256_sub_epi8(sum, _mm256_and_si256(wrapped, hundred));
+        _mm256_storeu_si256((__m256i *) (z + i), bcd_pack_avx2(sum));
+    }
+    return carry;
+}
+
+__attribute__((target("avx2")))
+bool sub_bcd_bytes_avx2(packed_BCD_pair *z, const packed_BCD_pair *x, const packed_BCD_pair *y, size_t n, bool carry)    {
+    // subtracts 32 packed bytes (64 digits) at a time. n must be a multiple of 32
+    const __m256i hundred = _mm256_set1_epi8(100), zero = _mm256_setzero_si256();
+    for (size_t i = 0; i < n; i += 32)  {
+        __m256i a = bcd_unpack_avx2(_mm256_loadu_si256((const __m256i *) (x + i)));
+        __m256i b = bcd_unpack_avx2(_mm256_loadu_si256((const __m256i *) (y + i)));
+        __m256i diff = _mm256_sub_epi8(a, b);
+        uint64_t generate = (uint32_t) _mm256_movemask_epi8(_mm256_cmpgt_epi8(zero, diff));
+        uint64_t propagate = generate | (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(diff, zero));
+        uint64_t borrows = generate + propagate + carry;
+        carry = borrows >> 32;
+        diff = _mm256_sub_epi8(diff, bcd_expand_mask_avx2((uint32_t) (borrows ^ generate ^ propagate)));
+        diff = _mm256_add_epi8(diff, _mm256_and_si256(_mm256_cmpgt_epi8(zero, diff), hundred));
+        _mm256_storeu_si256((__m256i *) (z + i), bcd_pack_avx2(diff));
+    }
+    return carry;
+}
+
+bool bcd_has_avx2(void) {
+    // checks the CPU once, then remembers the answer
+    static signed char cached = -1;
+    if (cached < 0) {
+        cached = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return cached;
+}
+#endif
+
+bool add_bcd_bytes(packed_BCD_pair *z, const packed_BCD_pair *x, const packed_BCD_pair *y, size_t n, bool carry)  {
+    // adds n packed bytes of x and y into z, and returns the carry out of the top byte
+    // on x86_64 this picks the widest vector kernel the CPU supports at runtime, then finishes with the scalar one
+    size_t done = 0;
+#if HAS_X64_SIMD
+    if (n >= 32 && bcd_has_avx2())  {
+        carry = add_bcd_bytes_avx2(z, x, y, n & ~(size_t) 31, carry);
+        done = n & ~(size_t) 31;
+    }
+    if (n - done >= 16) {
+        size_t len = (n - done) & ~(size_t) 15;
+        carry = add_bcd_bytes_sse2(z + done, x + done, y + done, len, carry);
+        done += len;
+    }
+#endif
+    return add_bcd_bytes_scalar(z + done, x + done, y + done, n - done, carry);
+}
+
+bool sub_bcd_bytes(packed_BCD_pair *z, const packed_BCD_pair *x, const packed_BCD_pair *y, size_t n, bool carry)  {
+    // subtracts n packed bytes of y from x into z, and returns the borrow out of the top byte
+    // on x86_64 this picks the widest vector kernel the CPU supports at runtime, then finishes with the scalar one
+    size_t done = 0;
+#if HAS_X64_SIMD
+    if (n >= 32 && bcd_has_avx2())  {
+        carry = sub_bcd_bytes_avx2(z, x, y, n & ~(size_t) 31, carry);
+        done = n & ~(size_t) 31;
+    }
+    if (n - done >= 16) {
+        size_t len = (n - done) & ~(size_t) 15;
+        carry = sub_bcd_bytes_sse2(z + done, x + done, y + done, len, carry);
+        done += len;
+    }
+#endif
+    return sub_bcd_bytes_scalar(z + done, x + done, y + done, n - done, carry);
+}
+
+BCD_int sub_bcd(BCD_int x, BCD_int y);
+
+BCD_int add_bcd(BCD_int x, BCD_int y)   {
+    // performing this on two n-digit numbers will take O(n) time
+    if (unlikely(x.zero))   {
+        return copy_BCD_int(y);
+    }
+    if (unlikely(y.zero))   {
+        return copy_BCD_int(x);
+    }
+    if (x.negative != y.negative)   {
+        // if signs don't match, absolute value would go down.
+        // that means we need to flip y's sign and move through sub_bcd()
+        y.negative = !y.negative;
+        return sub_bcd(x, y);
     }
+    BCD_int z;
+    size_t i, min_digits = min(x.bcd_digits, y.bcd_digits), max_digits = max(x.bcd_digits, y.bcd_digits);
+    z.zero = false;  // result can't be zero because x and y are non-zero and share a sign
+    z.negative = x.negative;  // we know this is also y.negative
+    packed_BCD_pair *z_digits = bcd_init_digits(&z, max_digits + 1), a;
+    bool overflow = add_bcd_bytes(z_digits, bcd_data(&x), bcd_data(&y), min_digits, false);
+    const packed_BCD_pair *x_digits = bcd_data((x.bcd_digits < y.bcd_digits) ? &y : &x);
+    i = min_digits;
     for (; overflow && i < max_digits; i++) {  // while there's overflow and digits, continue adding
-        a = x.digits[i] + overflow;
+        a = x_digits[i] + overflow;
         if ((a & 0x0F) == 0x0A) {  // since all that's left is overflow, we don't need to check ranges
             a += 0x06;
         }
         if ((overflow = ((a & 0xF0) == 0xA0)))  {
             a += 0x60;
         }
-        z.digits[i] = a;
+        z_digits[i] = a;
     }
     for (; i < max_digits; i++) {  // if there's no more overflow, but still digits left, copy directly
-        z.digits[i] = x.digits[i];
+        z_digits[i] = x_digits[i];
     }
-    z.digits[max_digits] = overflow;
+    z_digits[max_digits] = overflow;
     z.bcd_digits = max_digits + overflow;
     if (overflow)   {
         z.decimal_digits = max_digits * 2 + 1;
     }
-    else if (z.digits[max_digits - 1] & 0xF0)   {
+    else if (z_digits[max_digits - 1] & 0xF0)   {
         z.decimal_digits = max_digits * 2;
     }
     else    {
@@ -224,103 +757,300 @@ BCD_int add_bcd(BCD_int x, BCD_int y)   {
     return z;
 }
 
-BCD_int mul_bcd_pow_10(BCD_int x, uintmax_t tens)   {
-    // this takes O(log_100(x)) time. Note that it's significantly faster if tens is even
-    // returns x * 10^tens
-    BCD_int ret;
-    if (unlikely(x.zero))   {
-        return new_BCD_int(0, false);
+// the *_into() functions below update their first argument in place instead of returning a new BCD_int
+// the destination keeps its buffer between calls and grows it geometrically, so a loop that keeps adding to or
+// scaling a running total does no allocation once the total stops growing
+
+void reserve_bcd(BCD_int *x, size_t bytes)  {
+    // makes sure x has room for at least bytes packed bytes. growth at least doubles, so this is amortized O(1)
+    if (x->capacity >= bytes)   {
+        return;
     }
-    ret.zero = false;
-    ret.negative = x.negative;
-    ret.decimal_digits = x.decimal_digits + tens;
-    ret.bcd_digits = (ret.decimal_digits + 1) / 2;
-    ret.digits = (packed_BCD_pair *) calloc(ret.bcd_digits, sizeof(packed_BCD_pair));
-    if (tens % 2 == 0)  {
-        // +--+--+    +--+--+--+
-        // |23|01| -> ...|23|01|
-        // +--+--+    +--+--+--+
-        const size_t digit_diff = ret.bcd_digits - x.bcd_digits;
-        memcpy(ret.digits + digit_diff, x.digits, x.bcd_digits);
+    if (bytes <= BCD_SMALL_BYTES)   {  // still fits inside the struct
+        x->capacity = BCD_SMALL_BYTES;
+        return;
+    }
+    size_t capacity = max(bytes, x->capacity * 2);
+    if (x->capacity <= BCD_SMALL_BYTES) {
+        packed_BCD_pair *heap = (packed_BCD_pair *) bcd_alloc(sizeof(packed_BCD_pair) * capacity);
+        memcpy(heap, x->digits.small, BCD_SMALL_BYTES);  // callers may have written past bcd_digits already
+        x->digits.heap = heap;
     }
     else    {
-        // +--+--+    +--+--+--+
-        // |23|01| -> ...|30|12|
-        // +--+--+    +--+--+--+
-        // +--+--+    +--+--+--+--+
-        // |34|12| -> ...|40|23|01|
-        // +--+--+    +--+--+--+--+
-        const size_t digit_diff = ret.bcd_digits - x.bcd_digits - ret.decimal_digits % 2;
-        // note that digit_diff needs to be adjusted on this branch, so it can't be common
-        ret.digits[digit_diff] = x.digits[0] << 4;
-        for (size_t i = 1; i < x.bcd_digits; i++)   {
-            ret.digits[i + digit_diff] = x.digits[i] << 4;
-            ret.digits[i + digit_diff] |= x.digits[i - 1] >> 4;
-        }
-        ret.digits[x.bcd_digits + digit_diff] |= x.digits[x.bcd_digits - 1] >> 4;
+        x->digits.heap = (packed_BCD_pair *) bcd_resize(x->digits.heap, x->capacity, sizeof(packed_BCD_pair) * capacity);
     }
-    return ret;
+    x->capacity = capacity;
 }
 
-BCD_int shift_bcd_left(BCD_int x, uintmax_t tens);
-inline BCD_int shift_bcd_left(BCD_int x, uintmax_t tens)    {
-    return mul_bcd_pow_10(x, tens);
+void normalize_bcd(BCD_int *x)  {
+    // drops leading zero bytes after an in-place operation, then recomputes decimal_digits and zero
+    const packed_BCD_pair *digits = bcd_data(x);
+    size_t i = x->bcd_digits;
+    while (i && !digits[i - 1])  {
+        i--;
+    }
+    x->bcd_digits = i;
+    if ((x->zero = !i)) {
+        x->decimal_digits = 0;
+        x->negative = false;
+        return;
+    }
+    x->decimal_digits = i * 2 - !(digits[i - 1] & 0xF0);
 }
 
-BCD_int mul_bcd_cuint(BCD_int x, uintmax_t y)   {
-    // this takes roughly O(log(y) * log(x)) time, and is nearly linear if y is a multiple of 10
-    // it works by breaking the multiplication down into groups of addition
-    // full formula for performance is something like:
-    // y = 10^a * b
-    // f(i) = sum(n = 1 thru 19, (i % 10^(n + 1)) / 10^n) + i / 10^20
-    // bool(i) = 1 if i else 0
-    // time = O(bool(a) * log_100(x) + f(b) * log_100(xy))
-    if (unlikely(!y || x.zero)) {
-        return new_BCD_int(0, false);
+signed char cmp_bcd_magnitude(BCD_int x, BCD_int y)  {
+    // returns:
+    // 1 if |x| > |y|
+    // -1 if |y| > |x|
+    // else 0
+    if (x.decimal_digits != y.decimal_digits)  {
+        return (x.decimal_digits > y.decimal_digits) ? 1 : -1;
+    }
+    const packed_BCD_pair *x_digits = bcd_data(&x), *y_digits = bcd_data(&y);
+    for (size_t i = x.bcd_digits - 1; i != -1; i--) {
+        if (x_digits[i] != y_digits[i]) {
+            return (x_digits[i] > y_digits[i]) ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+void add_bcd_into(BCD_int *acc, BCD_int x)  {
+    // adds x to acc in place. this takes O(n) time, and only allocates if acc runs out of capacity
+    if (unlikely(x.zero))   {
+        return;
+    }
+    if (acc->zero)  {
+        acc->negative = x.negative;
+    }
+    size_t i, len = max(acc->bcd_digits, x.bcd_digits);
+    reserve_bcd(acc, len + 1);
+    packed_BCD_pair a, *digits = bcd_data(acc);
+    memset(digits + acc->bcd_digits, 0, len + 1 - acc->bcd_digits);
+    if (acc->negative == x.negative)    {
+        bool overflow = add_bcd_bytes(digits, digits, bcd_data(&x), x.bcd_digits, false);
+        for (i = x.bcd_digits; overflow; i++)   {  // acc was zero-extended, so this always stops in bounds
+            a = digits[i] + 1;
+            if ((a & 0x0F) == 0x0A) {
+                a += 0x06;
+            }
+            if ((overflow = ((a & 0xF0) == 0xA0)))  {
+                a += 0x60;
+            }
+            digits[i] = a;
+        }
+        acc->bcd_digits = len + 1;
+    }
+    else if (cmp_bcd_magnitude(*acc, x) >= 0)   {
+        // |acc| shrinks, so subtract x from it
+        bool carry = sub_bcd_bytes(digits, digits, bcd_data(&x), x.bcd_digits, false);
+        for (i = x.bcd_digits; carry; i++)  {  // |acc| >= |x|, so the borrow is always absorbed
+            a = digits[i] - 1;
+            if ((a & 0x0F) == 0x0F) {
+                a -= 0x06;
+            }
+            if ((carry = ((a & 0xF0) == 0xF0)))  {
+                a -= 0x60;
+            }
+            digits[i] = a;
+        }
+        acc->bcd_digits = len;
+    }
+    else    {
+        // |x| is bigger, so acc becomes x - acc. acc was zero-extended to x's length, so this can't borrow out
+        sub_bcd_bytes(digits, bcd_data(&x), digits, x.bcd_digits, false);
+        acc->bcd_digits = len;
+        acc->negative = x.negative;
+    }
+    normalize_bcd(acc);
+}
+
+void sub_bcd_into(BCD_int *acc, BCD_int x);
+inline void sub_bcd_into(BCD_int *acc, BCD_int x)   {
+    // subtracts x from acc in place
+    x.negative = !x.negative;
+    add_bcd_into(acc, x);
+}
+
+void mul_bcd_pow_10_into(BCD_int *acc, uintmax_t tens)  {
+    // multiplies acc by 10^tens in place. this takes O(log_100(acc) + tens) time
+    if (unlikely(acc->zero || !tens))   {
+        return;
+    }
+    size_t i, shift = tens / 2, len = acc->bcd_digits + shift + tens % 2;
+    reserve_bcd(acc, len);
+    packed_BCD_pair *digits = bcd_data(acc);
+    memmove(digits + shift, digits, acc->bcd_digits);
+    memset(digits, 0, shift);
+    if (tens % 2)   {
+        // then move everything up by one more nibble
+        digits[len - 1] = 0;
+        for (i = len - 1; i > shift; i--)   {
+            digits[i] = (digits[i] << 4) | (digits[i - 1] >> 4);
+        }
+        digits[shift] <<= 4;
+    }
+    acc->bcd_digits = len;
+    normalize_bcd(acc);
+}
+
+// multiplying by a machine word works on 8 digits at a time. 4 packed bytes become a binary number below 10^8, which
+// is multiplied by y and added to the running carry, then the low 8 decimal digits of that go back through a table
+// of packed pairs, and the rest carries into the next group
+#define BCD_PAIR_ROW(t) 0x##t##0, 0x##t##1, 0x##t##2, 0x##t##3, 0x##t##4, 0x##t##5, 0x##t##6, 0x##t##7, 0x##t##8, 0x##t##9
+static const packed_BCD_pair bcd_pair_table[100] = {
+    BCD_PAIR_ROW(0), BCD_PAIR_ROW(1), BCD_PAIR_ROW(2), BCD_PAIR_ROW(3), BCD_PAIR_ROW(4),
+    BCD_PAIR_ROW(5), BCD_PAIR_ROW(6), BCD_PAIR_ROW(7), BCD_PAIR_ROW(8), BCD_PAIR_ROW(9)
+};
+#undef BCD_PAIR_ROW
+
+#define BCD_WORD_BASE 100000000ULL
+// 2^64 = BCD_WORD_SPLIT_Q * 10^8 + BCD_WORD_SPLIT_R, which lets a 128-bit total be split without a 128-bit division
+#define BCD_WORD_SPLIT_Q 184467440737ULL
+#define BCD_WORD_SPLIT_R 9551616ULL
+
+uint32_t bcd_load_word(const packed_BCD_pair *x);
+inline uint32_t bcd_load_word(const packed_BCD_pair *x) {
+    // converts the 4 packed bytes at x into binary, a pair of bytes at a time, without any division
+    uint32_t w = x[0] | (x[1] << 8) | ((uint32_t) x[2] << 16) | ((uint32_t) x[3] << 24);
+    w -= 6 * ((w >> 4) & 0x0F0F0F0F);  // each byte is now 10 * high + low
+    w = (w & 0x00FF00FF) + 100 * ((w >> 8) & 0x00FF00FF);
+    return (w & 0xFFFF) + 10000 * (w >> 16);
+}
+
+void bcd_store_word(packed_BCD_pair *z, uint32_t w);
+inline void bcd_store_word(packed_BCD_pair *z, uint32_t w)  {
+    // writes w, which must be below 10^8, as 4 packed bytes at z
+    uint32_t hi = w / 10000, lo = w % 10000;
+    z[0] = bcd_pair_table[lo % 100];
+    z[1] = bcd_pair_table[lo / 100];
+    z[2] = bcd_pair_table[hi % 100];
+    z[3] = bcd_pair_table[hi / 100];
+}
+
+size_t mul_bcd_bytes_cuint(packed_BCD_pair *z, const packed_BCD_pair *x, size_t n, uint64_t y)   {
+    // writes the n bytes at x times y into z, which may be x, and returns how many bytes were written
+    // z needs room for n + (count_digits(y) + 1) / 2 bytes, rounded up to a multiple of 4
+    // the carry into each group stays below y, so y * (10^8 - 1) + carry fits in 64 bits when y <= 2^64 / 10^8.
+    // Anything bigger takes the 128-bit product, split using 2^64 = q * 10^8 + r
+    uint64_t carry = 0, total, hi;
+    packed_BCD_pair tail[4] = {0, 0, 0, 0};
+    size_t i;
+    for (i = 0; i < n; i += 4)  {
+        const packed_BCD_pair *src = x + i;
+        if (n - i < 4)  {
+            memcpy(tail, x + i, n - i);
+            src = tail;
+        }
+        if (y <= UINT64_MAX / BCD_WORD_BASE)   {
+            total = bcd_load_word(src) * y + carry;
+            carry = total / BCD_WORD_BASE;
+        }
+        else    {
+            total = mul_64x64(bcd_load_word(src), y, &hi);
+            total += carry;
+            hi += (total < carry);
+            uint64_t rest = total + hi * BCD_WORD_SPLIT_R;
+            carry = hi * BCD_WORD_SPLIT_Q;
+            if (rest < total)   {  // hi * r + total went past 2^64
+                carry += BCD_WORD_SPLIT_Q;
+                rest += BCD_WORD_SPLIT_R;
+            }
+            carry += rest / BCD_WORD_BASE;
+            total = rest;
+        }
+        bcd_store_word(z + i, total % BCD_WORD_BASE);
     }
-    unsigned char tens = 0;  // will up size when there's an 848-bit system
-    BCD_int ret, sum, mul_by_power_10;
-    // first remove factors of ten
-    while (y % 10 == 0) {
-        y /= 10;
-        ++tens;
+    for (; carry; i += 4, carry /= BCD_WORD_BASE)   {
+        bcd_store_word(z + i, carry % BCD_WORD_BASE);
     }
-    if (tens)   {
-        ret = mul_bcd_pow_10(x, tens);
+    return i;
+}
+
+void mul_bcd_cuint_into(BCD_int *acc, uintmax_t y)  {
+    // multiplies acc by y in place, in a single pass over its bytes, which takes O(log_100(acc) + log_100(y)) time
+    if (unlikely(!y || acc->zero))  {
+        acc->bcd_digits = 0;
+        normalize_bcd(acc);
+        return;
+    }
+    size_t n = acc->bcd_digits;
+    reserve_bcd(acc, (n + (count_digits(y) + 1) / 2 + 3) & ~(size_t) 3);
+    packed_BCD_pair *digits = bcd_data(acc);
+    acc->bcd_digits = mul_bcd_bytes_cuint(digits, digits, n, y);
+    normalize_bcd(acc);
+}
+
+BCD_int mul_bcd_pow_10(BCD_int x, uintmax_t tens)   {
+    // this takes O(log_100(x)) time. Note that it's significantly faster if tens is even
+    // returns x * 10^tens
+    BCD_int ret;
+    if (unlikely(x.zero))   {
+        return new_BCD_int(0, false);
+    }
+    ret.zero = false;
+    ret.negative = x.negative;
+    ret.decimal_digits = x.decimal_digits + tens;
+    ret.bcd_digits = (ret.decimal_digits + 1) / 2;
+    packed_BCD_pair *digits = bcd_init_digits(&ret, ret.bcd_digits);
+    const packed_BCD_pair *x_digits = bcd_data(&x);
+    memset(digits, 0, ret.bcd_digits);
+    if (tens % 2 == 0)  {
+        // +--+--+    +--+--+--+
+        // |23|01| -> ...|23|01|
+        // +--+--+    +--+--+--+
+        const size_t digit_diff = ret.bcd_digits - x.bcd_digits;
+        memcpy(digits + digit_diff, x_digits, x.bcd_digits);
     }
     else    {
-        ret = new_BCD_int(0, x.negative);
-    }
-    // then for decreasing powers of ten, batch additions
-    uintmax_t p = (sizeof(uintmax_t) == 16) ? MAX_POW_10_128 : MAX_POW_10_64;
-    tens = (sizeof(uintmax_t) == 16) ? POW_OF_MAX_POW_10_128 : POW_OF_MAX_POW_10_64;
-    for (; p > 1; p /= 10, --tens)  {
-        while (y >= p)  {
-            mul_by_power_10 = mul_bcd_pow_10(x, tens);
-            sum = add_bcd(ret, mul_by_power_10);
-            free_BCD_int(mul_by_power_10);
-            free_BCD_int(ret);
-            ret = sum;
-            y -= p;
-        }
-    }
-    // then do simple addition
-    while (y--) {
-        sum = add_bcd(ret, x);
-        free_BCD_int(ret);
-        ret = sum;
+        // +--+--+    +--+--+--+
+        // |23|01| -> ...|30|12|
+        // +--+--+    +--+--+--+
+        // +--+--+    +--+--+--+--+
+        // |34|12| -> ...|40|23|01|
+        // +--+--+    +--+--+--+--+
+        const size_t digit_diff = ret.bcd_digits - x.bcd_digits - ret.decimal_digits % 2;
+        // note that digit_diff needs to be adjusted on this branch, so it can't be common
+        digits[digit_diff] = x_digits[0] << 4;
+        for (size_t i = 1; i < x.bcd_digits; i++)   {
+            digits[i + digit_diff] = x_digits[i] << 4;
+            digits[i + digit_diff] |= x_digits[i - 1] >> 4;
+        }
+        if (x.bcd_digits + digit_diff < ret.bcd_digits) {  // the top nibble only spills over if it was set
+            digits[x.bcd_digits + digit_diff] |= x_digits[x.bcd_digits - 1] >> 4;
+        }
     }
     return ret;
 }
 
-BCD_int pow_cuint_cuint(uintmax_t x, uintmax_t y);
-inline BCD_int pow_cuint_cuint(uintmax_t x, uintmax_t y)    {
-    // this takes roughly O(xylog_100(xy)) time
+BCD_int shift_bcd_left(BCD_int x, uintmax_t tens);
+inline BCD_int shift_bcd_left(BCD_int x, uintmax_t tens)    {
+    return mul_bcd_pow_10(x, tens);
+}
+
+BCD_int mul_bcd_cuint(BCD_int x, uintmax_t y)   {
+    // this takes O(log_100(x) + log_100(y)) time
+    // see mul_bcd_cuint_into
+    BCD_int ret = copy_BCD_int(x);
+    mul_bcd_cuint_into(&ret, y);
+    return ret;
+}
+
+BCD_int mul_bcd(BCD_int x, BCD_int y);
+
+BCD_int pow_cuint_cuint(uintmax_t x, uintmax_t y)   {
+    // this takes O(log(y)) multiplications, by squaring for each bit of y from the top down
+    // the extra factors of x are only a machine word, so they go through mul_bcd_cuint_into instead of mul_bcd
     BCD_int answer = new_BCD_int(1, false), tmp;
-    while (y--) {
-        tmp = mul_bcd_cuint(answer, x);
+    uintmax_t mask = ~(UINTMAX_MAX >> 1);
+    for (; mask && !(y & mask); mask >>= 1);
+    for (; mask; mask >>= 1)    {
+        tmp = mul_bcd(answer, answer);
         free_BCD_int(answer);
         answer = tmp;
+        if (y & mask)   {
+            mul_bcd_cuint_into(&answer, x);
+        }
     }
     return answer;
 }
@@ -338,52 +1068,207 @@ inline unsigned short mul_dig_pair(packed_BCD_pair ab, packed_BCD_pair cd)  {
     return 100 * a * c + 10 * (a * d + b * c) + b * d;
 }
 
+// multiplication works on little-endian arrays of base 10^4 limbs, built from pairs of packed bytes
+// coefficients are summed lazily in 64 bits and only carried once at the end. Karatsuba carries its half sums back
+// under BCD_LIMB_BASE before recursing, so they can't double at every level, and coefficients stay far below 2^63
+#define BCD_LIMB_BASE 10000
+
+#ifndef BCD_KARATSUBA_THRESHOLD
+    // below this many limbs, schoolbook multiplication beats the bookkeeping of Karatsuba
+    #define BCD_KARATSUBA_THRESHOLD 32
+#endif
+
+size_t bcd_to_limbs(BCD_int x, uint64_t *limbs) {
+    // unpacks x into base 10^4 limbs and returns how many were written, which is (x.bcd_digits + 1) / 2
+    const packed_BCD_pair *digits = bcd_data(&x);
+    size_t i, len = (x.bcd_digits + 1) / 2;
+    for (i = 0; i < x.bcd_digits / 2; i++)  {
+        packed_BCD_pair lo = digits[2 * i], hi = digits[2 * i + 1];
+        limbs[i] = (hi >> 4) * 1000 + (hi & 0xF) * 100 + (lo >> 4) * 10 + (lo & 0xF);
+    }
+    if (x.bcd_digits % 2)   {
+        limbs[i] = (digits[2 * i] >> 4) * 10 + (digits[2 * i] & 0xF);
+    }
+    return len;
+}
+
+BCD_int bcd_from_limbs(uint64_t *limbs, size_t len, bool negative)   {
+    // carries an array of (possibly oversized) base 10^4 coefficients into a BCD_int. limbs is clobbered
+    // Karatsuba's subtractions can leave individual coefficients negative, wrapped around in 64 bits, even though
+    // the number they add up to isn't, so the carry is done signed
+    BCD_int ret;
+    int64_t carry = 0;
+    for (size_t i = 0; i < len; i++)    {
+        carry += (int64_t) limbs[i];
+        int64_t limb = carry % (int64_t) BCD_LIMB_BASE;
+        if (limb < 0)   {
+            limb += BCD_LIMB_BASE;
+        }
+        limbs[i] = limb;
+        carry = (carry - limb) / (int64_t) BCD_LIMB_BASE;
+    }
+    // callers size the product so that it always fits, so carry is 0 here
+    while (len && !limbs[len - 1])  {
+        len--;
+    }
+    if (!len)   {
+        return new_BCD_int(0, false);
+    }
+    ret.zero = false;
+    ret.negative = negative;
+    packed_BCD_pair *digits = bcd_init_digits(&ret, len * 2);
+    for (size_t i = 0; i < len; i++)    {
+        unsigned short limb = limbs[i];
+        digits[2 * i] = (((limb / 10) % 10) << 4) | (limb % 10);
+        digits[2 * i + 1] = ((limb / 1000) << 4) | ((limb / 100) % 10);
+    }
+    ret.bcd_digits = len * 2 - (digits[len * 2 - 1] == 0);
+    ret.decimal_digits = ret.bcd_digits * 2 - !(digits[ret.bcd_digits - 1] & 0xF0);
+    return ret;
+}
+
+void mul_limbs_schoolbook(const uint64_t *a, size_t a_len, const uint64_t *b, size_t b_len, uint64_t *out)   {
+    // adds the product of a and b into out, which must have room for a_len + b_len coefficients. O(a_len * b_len)
+    for (size_t i = 0; i < a_len; i++)  {
+        const uint64_t ai = a[i];
+        if (!ai)    {
+            continue;
+        }
+        uint64_t *row = out + i;
+        for (size_t j = 0; j < b_len; j++)  {
+            row[j] += ai * b[j];
+        }
+    }
+}
+
+void mul_limbs_karatsuba(const uint64_t *a, const uint64_t *b, size_t n, uint64_t *out, uint64_t *scratch)  {
+    // writes the 2n coefficient product of two n limb numbers to out, using about 8n words of scratch
+    // with a = a1 * B^h + a0 and b = b1 * B^h + b0, the middle term a1b0 + a0b1 is (a0 + a1)(b0 + b1) - a0b0 - a1b1
+    // the sums get carried back under B in every limb but the top one, which only grows by B per level, so the limbs
+    // stay small at any depth. That makes the difference exact as a number, but not coefficient by coefficient, so
+    // some coefficients may wrap below 0, which bcd_from_limbs() undoes
+    if (n <= BCD_KARATSUBA_THRESHOLD)   {
+        memset(out, 0, sizeof(uint64_t) * 2 * n);
+        mul_limbs_schoolbook(a, n, b, n, out);
+        return;
+    }
+    size_t h = n / 2, k = n - h, i;
+    uint64_t *a_sum = scratch, *b_sum = scratch + k, *mid = scratch + 2 * k;
+    mul_limbs_karatsuba(a, b, h, out, scratch);
+    mul_limbs_karatsuba(a + h, b + h, k, out + 2 * h, scratch);
+    for (i = 0; i < h; i++) {
+        a_sum[i] = a[i] + a[h + i];
+        b_sum[i] = b[i] + b[h + i];
+    }
+    if (k > h)  {
+        a_sum[h] = a[2 * h];
+        b_sum[h] = b[2 * h];
+    }
+    // below the top limb, both halves are under B, so each sum is under 2B and carries at most 1
+    for (i = 0; i + 1 < k; i++) {
+        uint64_t a_carry = (a_sum[i] >= BCD_LIMB_BASE), b_carry = (b_sum[i] >= BCD_LIMB_BASE);
+        a_sum[i] -= a_carry * BCD_LIMB_BASE;
+        b_sum[i] -= b_carry * BCD_LIMB_BASE;
+        a_sum[i + 1] += a_carry;
+        b_sum[i + 1] += b_carry;
+    }
+    mul_limbs_karatsuba(a_sum, b_sum, k, mid, scratch + 4 * k);
+    for (i = 0; i < 2 * h; i++) {
+        mid[i] -= out[i];
+    }
+    for (i = 0; i < 2 * k; i++) {
+        mid[i] -= out[2 * h + i];
+    }
+    for (i = 0; i < 2 * k; i++) {
+        out[h + i] += mid[i];
+    }
+}
+
 BCD_int mul_bcd(BCD_int x, BCD_int y)   {
-    // multiplies two BCD ints by breaking them down into their component bytes and adding the results
-    // this takes O(log_100(x) * log_100(y) * log_100(xy)) time
-    BCD_int answer = new_BCD_int(0, false), addend, tmp;
+    // multiplies two BCD ints by converting them to base 10^4 limbs
+    // small or lopsided operands use schoolbook multiplication, which takes O(log(x) * log(y)) time
+    // past BCD_KARATSUBA_THRESHOLD limbs, this uses Karatsuba, which takes O(log(max(x, y))^1.585) time
     if (unlikely(x.zero || y.zero)) {
-        return answer;
+        return new_BCD_int(0, false);
     }
-    size_t i, j;
-    unsigned short staging;
-    uintmax_t ipow_10 = 0, pow_10;
-    for (i = 0; i < x.bcd_digits; i++, ipow_10 += 2)  {
-        for (j = 0, pow_10 = ipow_10; j < y.bcd_digits; j++, pow_10 += 2) {
-            staging = mul_dig_pair(x.digits[i], y.digits[j]);
-            if (staging == 0)   {
-                continue;
-            }
-            if (likely(pow_10)) {
-                tmp = new_BCD_int(staging, false);
-                addend = mul_bcd_pow_10(tmp, pow_10);  // this was not added to performance analysis
-                free_BCD_int(tmp);
+    if (x.bcd_digits < y.bcd_digits)    {
+        BCD_int tmp = x;
+        x = y;
+        y = tmp;
+    }
+    size_t x_len = (x.bcd_digits + 1) / 2, y_len = (y.bcd_digits + 1) / 2;
+    uint64_t *a = (uint64_t *) bcd_alloc(sizeof(uint64_t) * x_len);
+    uint64_t *b = (uint64_t *) bcd_alloc(sizeof(uint64_t) * y_len);
+    uint64_t *out = (uint64_t *) bcd_alloc(sizeof(uint64_t) * (x_len + y_len));
+    memset(out, 0, sizeof(uint64_t) * (x_len + y_len));
+    bcd_to_limbs(x, a);
+    bcd_to_limbs(y, b);
+    if (y_len <= BCD_KARATSUBA_THRESHOLD)   {
+        mul_limbs_schoolbook(a, x_len, b, y_len, out);
+    }
+    else    {
+        // multiply y by each y_len limb block of x, so that every Karatsuba call is balanced
+        uint64_t *block = (uint64_t *) bcd_alloc(sizeof(uint64_t) * 2 * y_len);
+        uint64_t *padded = (uint64_t *) bcd_alloc(sizeof(uint64_t) * y_len);
+        memset(padded, 0, sizeof(uint64_t) * y_len);
+        uint64_t *scratch = (uint64_t *) bcd_alloc(sizeof(uint64_t) * (8 * y_len + 256));
+        for (size_t start = 0; start < x_len; start += y_len)   {
+            const uint64_t *chunk = a + start;
+            if (x_len - start < y_len)  {
+                memcpy(padded, chunk, sizeof(uint64_t) * (x_len - start));
+                chunk = padded;
             }
-            else    {
-                addend = new_BCD_int(staging, false);;
+            mul_limbs_karatsuba(chunk, b, y_len, block, scratch);
+            for (size_t i = 0; i < 2 * y_len && start + i < x_len + y_len; i++)  {
+                out[start + i] += block[i];
             }
-            tmp = add_bcd(answer, addend);
-            free_BCD_int(addend);
-            free_BCD_int(answer);
-            answer = tmp;
         }
+        bcd_release(block, sizeof(uint64_t) * 2 * y_len);
+        bcd_release(padded, sizeof(uint64_t) * y_len);
+        bcd_release(scratch, sizeof(uint64_t) * (8 * y_len + 256));
     }
-    answer.negative = !(x.negative == y.negative);
+    BCD_int answer = bcd_from_limbs(out, x_len + y_len, x.negative != y.negative);
+    bcd_release(a, sizeof(uint64_t) * x_len);
+    bcd_release(b, sizeof(uint64_t) * y_len);
+    bcd_release(out, sizeof(uint64_t) * (x_len + y_len));
     return answer;
 }
 
 BCD_int pow_bcd(BCD_int x, BCD_int y)   {
-    // this takes O(y * 2log_100(x) * log_100(x)^2) time
-    BCD_int answer = new_BCD_int(1, false), tmp, one = new_BCD_int(1, false);
-    while (!y.zero) {
-        tmp = mul_bcd(answer, x);
-        free_BCD_int(answer);
-        answer = tmp;
-        tmp = sub_bcd(y, one);
-        free_BCD_int(y);
-        y = tmp;
+    // this takes O(log(y)) multiplications. y must not be negative, and is left untouched
+    // since y is already in decimal, this works a digit at a time from the top: answer = answer^10 * x^digit
+    BCD_int answer = new_BCD_int(1, false), powers[10], tmp;
+    bool started = false;  // squaring 1 is a waste of time, so wait for the first non-zero digit
+    if (y.zero) {
+        return answer;
+    }
+    powers[1] = copy_BCD_int(x);
+    for (unsigned char i = 2; i < 10; i++)  {
+        powers[i] = mul_bcd(powers[i - 1], x);
+    }
+    for (size_t i = y.decimal_digits - 1; i != -1; i--) {
+        unsigned char digit = (i % 2) ? (bcd_data(&y)[i / 2] >> 4) : (bcd_data(&y)[i / 2] & 0xF);
+        if (started)    {
+            // answer^10 = ((answer^2)^2 * answer)^2
+            BCD_int squared = mul_bcd(answer, answer);
+            tmp = mul_bcd(squared, squared);
+            free_BCD_int(squared);
+            squared = mul_bcd(tmp, answer);
+            free_BCD_int(tmp);
+            free_BCD_int(answer);
+            answer = mul_bcd(squared, squared);
+            free_BCD_int(squared);
+        }
+        if (digit)  {
+            tmp = mul_bcd(answer, powers[digit]);
+            free_BCD_int(answer);
+            answer = tmp;
+            started = true;
+        }
+    }
+    for (unsigned char i = 1; i < 10; i++)  {
+        free_BCD_int(powers[i]);
     }
-    free_BCD_int(one);
     return answer;
 }
 
@@ -395,19 +1280,8 @@ signed char cmp_bcd(BCD_int x, BCD_int y)   {
     if (x.negative != y.negative)   {
         return (x.negative) ? -1 : 1;
     }
-    if (x.decimal_digits != y.decimal_digits)  {
-        if (x.decimal_digits > y.decimal_digits)    {
-            return (x.negative) ? -1 : 1;
-        }
-        return (x.negative) ? 1 : -1;
-    }
-    for (size_t i = x.bcd_digits - 1; i != -1; i--) {
-        if (x.negative) {
-            return (x.digits[i] > y.digits[i]) ? -1 : 1;
-        }
-        return (x.digits[i] > y.digits[i]) ? 1 : -1;
-    }
-    return 0;
+    signed char ret = cmp_bcd_magnitude(x, y);
+    return (x.negative) ? -ret : ret;
 }
 
 BCD_int sub_bcd(BCD_int x, BCD_int y)   {
@@ -431,104 +1305,67 @@ BCD_int sub_bcd(BCD_int x, BCD_int y)   {
         return new_BCD_int(0, false);
     }
     z.negative = (cmp == -1);
-    size_t i, min_digits = min(x.bcd_digits, y.bcd_digits), max_digits = max(x.bcd_digits, y.bcd_digits);
-    z.digits = (packed_BCD_pair *) malloc(sizeof(packed_BCD_pair) * max_digits);
-    packed_BCD_pair a, b, c;
-    bool carry = false;
-    for (i = 0; i < min_digits; i++) {
-        a = x.digits[i];
-        b = y.digits[i];
-        if (!(carry || a))   {
-            c = b;
-            carry = false;
-        }
-        else if (!(carry || b))  {
-            c = a;
-            carry = false;
-        }
-        else    {
-            b += carry;  // incorporate carry from last pair
-            #if (!defined(NO_ASSEMBLY) && X86_COMPILER)
-                // if on these architectures, there's assembly tricks to adjust BCD in-silicon
-                #if CL_COMPILER
-                    // CL compiler has a different syntax for inline assembly, does a lot less lifting
-                    // note that the syntax here is: op [dest [, src]]
-                    // brackets indicate a C symbol is referenced rather than a register
-                    __asm   {
-                        mov al, [a];         // move C symbol a to register al
-                        sub al, [b];         // add C symbol b to register al
-                        das;                 // have the CPU make sure register al contains valid, packed BCD digits
-                        setc [carry];        // set C symbol carry to contain the carry bit, set by daa
-                        mov [c], al;         // move register al to C symbol c
-                    }
-                #else
-                    // this is the standard GCC/LLVM syntax for it
-                    // note that the syntax here is: op [[src, ] dest]
-                    // %\d indicates a C symbol is referenced, see the lookups at the end of code for which
-                    __asm__(
-                        "sub %3, %%al;"    // add the register containing b to al
-                        "das;"             // have the CPU make sure register al contains valid, packed BCD digits
-                        "setc %1;"         // set the register containing carry to hold the carry bit, set by daa
-                                           // this next section tells the compiler what to do after execution
-                      : "=a" (c),          // store the contents of register al in symbol c
-                        "=rgm" (carry)     // and a general register or memory location gets assigned to symbol carry (referenced as %1)
-                                           // then below tells the compiler what our inputs are
-                      : "a" (a),           // symbol a should get dumped to register al
-                        "rgm" (b)          // and symbol b in a general register or memory location (referenced as %3)
-                    );
-                #endif
-            #else
-                // otherwise fall back to doing it in C
-                c = a - b;                             // set c to be the result of (a - b) % 0x100
-                if ((carry = (c & 0xF0) > 0x99))    {  // if c would overflow the decimal range
-                    c -= 0x60;                         // and subtract 0x60 to make a decimal digit
-                }
-                if ((c & 0x0F) > 9)  {                 // if the lower nibble be bigger than 9
-                    c -= 0x06;                         // subtract 6 to make a decimal digit
-                }
-            #endif
-            }
-        z.digits[i] = c;
-    }
-    if (x.bcd_digits < y.bcd_digits)    {
+    if (z.negative != x.negative)   {
+        // always subtract the smaller magnitude from the larger one
+        BCD_int tmp = x;
         x = y;
+        y = tmp;
     }
-    for (; carry && i < max_digits; i++) {  // while there's carry and digits, continue adding
-        a = x.digits[i] - carry;
+    size_t i, min_digits = y.bcd_digits, max_digits = x.bcd_digits;
+    packed_BCD_pair *z_digits = bcd_init_digits(&z, max_digits), a;
+    const packed_BCD_pair *x_digits = bcd_data(&x);
+    bool carry = sub_bcd_bytes(z_digits, x_digits, bcd_data(&y), min_digits, false);
+    for (i = min_digits; carry && i < max_digits; i++) {  // while there's carry and digits, continue subtracting
+        a = x_digits[i] - carry;
         if ((a & 0x0F) == 0x0F) {  // since all that's left is carry, we don't need to check ranges
             a -= 0x06;
         }
         if ((carry = ((a & 0xF0) == 0xF0)))  {
             a -= 0x60;
         }
-        z.digits[i] = a;
+        z_digits[i] = a;
     }
     for (; i < max_digits; i++) {  // if there's no more carry, but still digits left, copy directly
-        z.digits[i] = x.digits[i];
-    }
-    z.bcd_digits = i;
-    z.decimal_digits = z.bcd_digits / 2;
-    if (!(z.digits[i - 1] & 0xF0))  {
-        z.decimal_digits--;
+        z_digits[i] = x_digits[i];
     }
+    // leading digits can cancel out, so find the new top
+    for (i = max_digits - 1; !z_digits[i]; i--);
+    z.bcd_digits = i + 1;
+    z.decimal_digits = z.bcd_digits * 2 - !(z_digits[i] & 0xF0);
     return z;
 }
 
 BCD_int div_bcd_pow_10(BCD_int a, uintmax_t tens)   {
-    if (unlikely(a.zero))   {
+    // this takes O(log_100(a)) time, and rounds towards zero. Like mul_bcd_pow_10, it's faster if tens is even
+    // returns a / 10^tens
+    if (unlikely(a.zero || !tens))  {
         return copy_BCD_int(a);
     }
+    if (tens >= a.decimal_digits)   {
+        return new_BCD_int(0, false);
+    }
     BCD_int ret;
+    size_t shift = tens / 2;
     ret.negative = a.negative;
     ret.zero = false;
     ret.decimal_digits = a.decimal_digits - tens;
+    ret.bcd_digits = (ret.decimal_digits + 1) / 2;
+    packed_BCD_pair *digits = bcd_init_digits(&ret, ret.bcd_digits);
+    const packed_BCD_pair *a_digits = bcd_data(&a);
     if (tens % 2 == 0)  {
-        ret.bcd_digits = a.bcd_digits - tens / 2;
-        ret.digits = (packed_BCD_pair *) malloc(sizeof(packed_BCD_pair) * ret.bcd_digits);
-        memcpy(ret.digits, a.digits + tens / 2, ret.bcd_digits);
+        // +--+--+--+    +--+
+        // |45|23|01| -> |45|
+        // +--+--+--+    +--+
+        memcpy(digits, a_digits + shift, ret.bcd_digits);
     }
     else    {
-        // TODO
+        // +--+--+--+    +--+--+
+        // |45|23|01| -> |04|52|
+        // +--+--+--+    +--+--+
+        for (size_t i = 0; i < ret.bcd_digits; i++) {
+            packed_BCD_pair hi = (shift + i + 1 < a.bcd_digits) ? a_digits[shift + i + 1] : 0;
+            digits[i] = ((hi & 0x0F) << 4) | (a_digits[shift + i] >> 4);
+        }
     }
     return ret;
 }
@@ -538,25 +1375,523 @@ inline BCD_int shift_bcd_right(BCD_int a, uintmax_t tens)   {
     return div_bcd_pow_10(a, tens);
 }
 
-void print_bcd(BCD_int x)   {
+// division section
+// small divisors are handled in a single pass from the top. Otherwise this is Knuth's Algorithm D on the same
+// base 10^4 limbs as multiplication, and once both the divisor and quotient are big enough, it switches to
+// multiplying by a reciprocal built with Newton's method, so that large divisions ride on Karatsuba
+
+#ifndef BCD_NEWTON_THRESHOLD
+    // below this many decimal digits in both the divisor and quotient, Algorithm D beats Newton's method
+    #define BCD_NEWTON_THRESHOLD 600
+#endif
+
+uintmax_t bcd_to_cuint(BCD_int x)   {
+    // returns |x|, which must fit in a uintmax_t
+    const packed_BCD_pair *digits = bcd_data(&x);
+    uintmax_t ret = 0;
+    for (size_t i = x.bcd_digits - 1; i != -1; i--) {
+        ret = ret * 100 + (digits[i] >> 4) * 10 + (digits[i] & 0xF);
+    }
+    return ret;
+}
+
+void divmod_bcd(BCD_int x, BCD_int y, BCD_int *quotient, BCD_int *remainder);
+
+BCD_int divmod_bcd_cuint(BCD_int x, uintmax_t y, uintmax_t *remainder)   {
+    // computes x / y, rounded towards zero. If remainder is not NULL, it gets |x| % y
+    // this takes O(log_100(x)) time for y up to UINTMAX_MAX / 100, and falls back to divmod_bcd() above that
+    if (y > UINTMAX_MAX / 100)  {
+        BCD_int q, r, divisor = new_BCD_int(y, false);
+        divmod_bcd(x, divisor, &q, &r);
+        if (remainder != NULL)  {
+            *remainder = bcd_to_cuint(r);
+        }
+        free_BCD_int(divisor);
+        free_BCD_int(r);
+        return q;
+    }
+    BCD_int q = copy_BCD_int(x);
+    packed_BCD_pair *digits = bcd_data(&q);
+    uintmax_t r = 0;
+    for (size_t i = q.bcd_digits - 1; i != -1; i--) {
+        r = r * 100 + (digits[i] >> 4) * 10 + (digits[i] & 0xF);
+        digits[i] = (((r / y) / 10) << 4) | ((r / y) % 10);
+        r %= y;
+    }
+    if (remainder != NULL)  {
+        *remainder = r;
+    }
+    normalize_bcd(&q);
+    return q;
+}
+
+void divmod_limbs_schoolbook(uint64_t *q, uint64_t *u, size_t m, uint64_t *v, size_t n)    {
+    // Knuth's Algorithm D on base 10^4 limbs. u has m + 1 limbs, the last of which is 0, and v has n >= 2 limbs
+    // with a non-zero top. q gets the m - n + 1 limbs of the quotient, and u is left holding the remainder
+    // both u and v are multiplied by d first so that the top limb of v is at least half the base, which keeps
+    // each estimated quotient limb within 2 of the truth
+    uint64_t d = BCD_LIMB_BASE / (v[n - 1] + 1), carry = 0;
+    size_t i;
+    for (i = 0; i <= m; i++)    {
+        carry += u[i] * d;
+        u[i] = carry % BCD_LIMB_BASE;
+        carry /= BCD_LIMB_BASE;
+    }
+    for (i = 0, carry = 0; i < n; i++)  {
+        carry += v[i] * d;
+        v[i] = carry % BCD_LIMB_BASE;
+        carry /= BCD_LIMB_BASE;
+    }
+    for (size_t j = m - n; j != -1; j--)    {
+        uint64_t num = u[j + n] * BCD_LIMB_BASE + u[j + n - 1];
+        uint64_t qhat = num / v[n - 1], rhat = num % v[n - 1];
+        while (qhat >= BCD_LIMB_BASE || qhat * v[n - 2] > rhat * BCD_LIMB_BASE + u[j + n - 2])  {
+            qhat--;
+            if ((rhat += v[n - 1]) >= BCD_LIMB_BASE)    {
+                break;
+            }
+        }
+        // u[j..j+n] -= qhat * v
+        int64_t t, borrow = 0;
+        for (i = 0, carry = 0; i < n; i++)  {
+            uint64_t p = qhat * v[i] + carry;
+            carry = p / BCD_LIMB_BASE;
+            t = (int64_t) u[i + j] - (int64_t) (p % BCD_LIMB_BASE) - borrow;
+            borrow = (t < 0);
+            u[i + j] = t + borrow * BCD_LIMB_BASE;
+        }
+        t = (int64_t) u[j + n] - (int64_t) carry - borrow;
+        if (unlikely(t < 0))    {
+            // qhat was one too big, so add v back in
+            qhat--;
+            for (i = 0, carry = 0; i < n; i++)  {
+                carry += u[i + j] + v[i];
+                u[i + j] = carry % BCD_LIMB_BASE;
+                carry /= BCD_LIMB_BASE;
+            }
+            t += carry;
+        }
+        u[j + n] = t;
+        q[j] = qhat;
+    }
+    for (i = n - 1, carry = 0; i != -1; i--)    {
+        carry = carry * BCD_LIMB_BASE + u[i];
+        u[i] = carry / d;
+        carry %= d;
+    }
+}
+
+BCD_int bcd_reciprocal(BCD_int y, size_t p) {
+    // returns 10^(n + p) / y to within a few units, where y is positive and has n digits
+    // only the top p + 2 digits of y matter at this precision, and each Newton step doubles the precision of a
+    // half-size estimate: r = r0 + r0 * (10^(n + p) - y * r0) / 10^(n + p)
+    BCD_int yt = y, one = new_BCD_int(1, false), ret, tmp, err, pow;
+    size_t n = min(y.decimal_digits, p + 2);
+    if (n < y.decimal_digits)   {
+        yt = div_bcd_pow_10(y, y.decimal_digits - n);
+    }
+    pow = mul_bcd_pow_10(one, n + p);
+    if (p < BCD_NEWTON_THRESHOLD)   {
+        divmod_bcd(pow, yt, &ret, NULL);
+    }
+    else    {
+        size_t h = p / 2 + 1;
+        BCD_int half = bcd_reciprocal(yt, h);
+        // err = 10^(n + p) - yt * half * 10^(p - h), which is about n + p - h digits
+        tmp = mul_bcd(yt, half);
+        mul_bcd_pow_10_into(&tmp, p - h);
+        err = sub_bcd(pow, tmp);
+        free_BCD_int(tmp);
+        // ret = half * 10^(p - h) + half * err / 10^(n + h)
+        tmp = mul_bcd(half, err);
+        ret = div_bcd_pow_10(tmp, n + h);
+        free_BCD_int(tmp);
+        mul_bcd_pow_10_into(&half, p - h);
+        add_bcd_into(&ret, half);
+        free_BCD_int(half);
+        free_BCD_int(err);
+    }
+    if (n < y.decimal_digits)   {
+        free_BCD_int(yt);
+    }
+    free_BCD_int(one);
+    free_BCD_int(pow);
+    return ret;
+}
+
+void divmod_bcd(BCD_int x, BCD_int y, BCD_int *quotient, BCD_int *remainder)  {
+    // computes x / y, rounded towards zero, and the remainder, which takes the sign of x, like C's / and %
+    // either output can be NULL if you don't need it. y must be non-zero
+    // this takes O(log(x) * log(y)) time, or O(log(x)^1.585) once both y and x / y are big enough for Newton
+    BCD_int q, r;
+    if (cmp_bcd_magnitude(x, y) < 0)    {
+        q = new_BCD_int(0, false);
+        r = copy_BCD_int(x);
+    }
+    else if (y.decimal_digits <= 16)    {
+        uintmax_t rem;
+        q = divmod_bcd_cuint(x, bcd_to_cuint(y), &rem);
+        q.negative = !q.zero && (x.negative != y.negative);
+        r = new_BCD_int(rem, x.negative);
+        r.negative = !r.zero && x.negative;
+    }
+    else if (min(y.decimal_digits, x.decimal_digits - y.decimal_digits) > BCD_NEWTON_THRESHOLD)  {
+        // estimate with the reciprocal, then fix up the last couple of units
+        BCD_int abs_x = x, abs_y = y, one = new_BCD_int(1, false), tmp;
+        abs_x.negative = abs_y.negative = false;
+        size_t p = x.decimal_digits - y.decimal_digits + 2;
+        BCD_int recip = bcd_reciprocal(abs_y, p);
+        tmp = mul_bcd(abs_x, recip);
+        q = div_bcd_pow_10(tmp, y.decimal_digits + p);
+        free_BCD_int(tmp);
+        free_BCD_int(recip);
+        tmp = mul_bcd(q, abs_y);
+        r = sub_bcd(abs_x, tmp);
+        free_BCD_int(tmp);
+        while (!r.zero && r.negative)   {
+            sub_bcd_into(&q, one);
+            add_bcd_into(&r, abs_y);
+        }
+        while (cmp_bcd(r, abs_y) >= 0)  {
+            add_bcd_into(&q, one);
+            sub_bcd_into(&r, abs_y);
+        }
+        q.negative = !q.zero && (x.negative != y.negative);
+        r.negative = !r.zero && x.negative;
+        free_BCD_int(one);
+    }
+    else    {
+        size_t m = (x.bcd_digits + 1) / 2, n = (y.bcd_digits + 1) / 2;
+        uint64_t *u = (uint64_t *) bcd_alloc(sizeof(uint64_t) * (m + 1));
+        uint64_t *v = (uint64_t *) bcd_alloc(sizeof(uint64_t) * n);
+        uint64_t *q_limbs = (uint64_t *) bcd_alloc(sizeof(uint64_t) * (m - n + 1));
+        bcd_to_limbs(x, u);
+        bcd_to_limbs(y, v);
+        u[m] = 0;
+        divmod_limbs_schoolbook(q_limbs, u, m, v, n);
+        q = bcd_from_limbs(q_limbs, m - n + 1, x.negative != y.negative);
+        r = bcd_from_limbs(u, n, x.negative);
+        bcd_release(u, sizeof(uint64_t) * (m + 1));
+        bcd_release(v, sizeof(uint64_t) * n);
+        bcd_release(q_limbs, sizeof(uint64_t) * (m - n + 1));
+    }
+    if (quotient != NULL)   {
+        *quotient = q;
+    }
+    else    {
+        free_BCD_int(q);
+    }
+    if (remainder != NULL)  {
+        *remainder = r;
+    }
+    else    {
+        free_BCD_int(r);
+    }
+}
+
+BCD_int div_bcd(BCD_int x, BCD_int y);
+inline BCD_int div_bcd(BCD_int x, BCD_int y)    {
+    BCD_int ret;
+    divmod_bcd(x, y, &ret, NULL);
+    return ret;
+}
+
+BCD_int mod_bcd(BCD_int x, BCD_int y);
+inline BCD_int mod_bcd(BCD_int x, BCD_int y)    {
+    BCD_int ret;
+    divmod_bcd(x, y, NULL, &ret);
+    return ret;
+}
+
+// digit kernel section
+// these look at every digit of a BCD_int without unpacking it. The vector versions split each byte into its two
+// nibbles with a shift and a mask, and the reversal kernels flip byte order with shuffles, then swap or recombine
+// nibbles. Reversing an even number of digits swaps the nibbles of each mirrored byte. With an odd number, the
+// leading zero nibble shifts everything by one, so each output byte takes its low nibble from one mirrored byte and
+// its high nibble from the one below it
+
+packed_BCD_pair bcd_mirror_scalar(const packed_BCD_pair *x, size_t n, size_t i, bool odd) {
+    // returns byte i of the digit reversal of the n bytes at x, where odd says if the top nibble is a leading zero
+    packed_BCD_pair a = x[n - 1 - i];
+    if (!odd)   {
+        return (a >> 4) | (a << 4);
+    }
+    return (a & 0x0F) | ((i + 1 < n) ? (x[n - 2 - i] & 0xF0) : 0);
+}
+
+#if HAS_X64_SIMD
+__m128i bcd_reverse_sse2(__m128i v) {
+    // reverses the order of the bytes in v using only SSE2 shuffles
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+__m128i bcd_mirror_sse2(const packed_BCD_pair *x, size_t n, size_t i, bool odd) {
+    // returns bytes i thru i + 15 of the digit reversal, which needs i + 16 (or i + 17 if odd) to be at most n
+    const __m128i low = _mm_set1_epi8(0x0F);
+    __m128i a = bcd_reverse_sse2(_mm_loadu_si128((const __m128i *) (x + n - 16 - i)));
+    if (!odd)   {
+        return _mm_or_si128(_mm_and_si128(_mm_srli_epi16(a, 4), low), _mm_andnot_si128(low, _mm_slli_epi16(a, 4)));
+    }
+    __m128i b = bcd_reverse_sse2(_mm_loadu_si128((const __m128i *) (x + n - 17 - i)));
+    return _mm_or_si128(_mm_and_si128(a, low), _mm_andnot_si128(low, b));
+}
+
+__attribute__((target("avx2"))) __m256i bcd_reverse_avx2(__m256i v)  {
+    // pshufb only works within each 128-bit lane, so reverse both lanes, then swap them
+    const __m256i order = _mm256_setr_epi8(
+        15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+    );
+    return _mm256_permute4x64_epi64(_mm256_shuffle_epi8(v, order), _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+__attribute__((target("avx2")))
+__m256i bcd_mirror_avx2(const packed_BCD_pair *x, size_t n, size_t i, bool odd) {
+    // returns bytes i thru i + 31 of the digit reversal, which needs i + 32 (or i + 33 if odd) to be at most n
+    const __m256i low = _mm256_set1_epi8(0x0F);
+    __m256i a = bcd_reverse_avx2(_mm256_loadu_si256((const __m256i *) (x + n - 32 - i)));
+    if (!odd)   {
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(a, 4), low);
+        return _mm256_or_si256(high, _mm256_andnot_si256(low, _mm256_slli_epi16(a, 4)));
+    }
+    __m256i b = bcd_reverse_avx2(_mm256_loadu_si256((const __m256i *) (x + n - 33 - i)));
+    return _mm256_or_si256(_mm256_and_si256(a, low), _mm256_andnot_si256(low, b));
+}
+
+__attribute__((target("avx2")))
+size_t bcd_reverse_bytes_avx2(packed_BCD_pair *out, const packed_BCD_pair *x, size_t n, bool odd)    {
+    // writes as much of the digit reversal as whole steps allow, and returns how many bytes that was
+    size_t i = 0;
+    for (; i + 32 + odd <= n; i += 32)  {
+        _mm256_storeu_si256((__m256i *) (out + i), bcd_mirror_avx2(x, n, i, odd));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+bool bcd_mirror_match_avx2(const packed_BCD_pair *x, size_t n, size_t half, bool odd, size_t *i)   {
+    // compares x against its digit reversal up to half, and returns false at the first mismatch
+    for (; *i < half && *i + 32 + odd <= n; *i += 32)   {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (x + *i));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, bcd_mirror_avx2(x, n, *i, odd))) != -1)  {
+            return false;
+        }
+    }
+    return true;
+}
+
+__attribute__((target("avx2"))) uintmax_t bcd_digit_sum_avx2(const packed_BCD_pair *x, size_t n)  {
+    // each byte's two nibbles add to at most 18, and _mm256_sad_epu8 folds 8 of those into each 64-bit lane
+    const __m256i low = _mm256_set1_epi8(0x0F), zero = _mm256_setzero_si256();
+    __m256i total = zero;
+    for (size_t i = 0; i < n; i += 32)  {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (x + i));
+        __m256i digits = _mm256_add_epi8(_mm256_and_si256(v, low), _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(digits, zero));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *) lanes, total);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+__attribute__((target("avx2")))
+void bcd_digit_histogram_avx2(const packed_BCD_pair *x, size_t n, uintmax_t counts[10]) {
+    // counts 1 thru 9 in per-byte counters, which go up by at most 2 per step, so they're flushed every 127 steps
+    const __m256i low = _mm256_set1_epi8(0x0F), zero = _mm256_setzero_si256();
+    for (size_t start = 0; start < n; start += 127 * 32)    {
+        size_t stop = min(n, start + 127 * 32);
+        __m256i tally[10];
+        for (unsigned char d = 1; d < 10; d++)  {
+            tally[d] = zero;
+        }
+        for (size_t i = start; i < stop; i += 32)   {
+            __m256i v = _mm256_loadu_si256((const __m256i *) (x + i));
+            __m256i lo = _mm256_and_si256(v, low), hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+            for (unsigned char d = 1; d < 10; d++)  {
+                __m256i digit = _mm256_set1_epi8(d);
+                tally[d] = _mm256_sub_epi8(tally[d], _mm256_cmpeq_epi8(lo, digit));
+                tally[d] = _mm256_sub_epi8(tally[d], _mm256_cmpeq_epi8(hi, digit));
+            }
+        }
+        for (unsigned char d = 1; d < 10; d++)  {
+            uint64_t lanes[4];
+            _mm256_storeu_si256((__m256i *) lanes, _mm256_sad_epu8(tally[d], zero));
+            counts[d] += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        }
+    }
+}
+
+uintmax_t bcd_digit_sum_sse2(const packed_BCD_pair *x, size_t n)    {
+    const __m128i low = _mm_set1_epi8(0x0F), zero = _mm_setzero_si128();
+    __m128i total = zero;
+    for (size_t i = 0; i < n; i += 16)  {
+        __m128i v = _mm_loadu_si128((const __m128i *) (x + i));
+        __m128i digits = _mm_add_epi8(_mm_and_si128(v, low), _mm_and_si128(_mm_srli_epi16(v, 4), low));
+        total = _mm_add_epi64(total, _mm_sad_epu8(digits, zero));
+    }
+    return (uint64_t) _mm_cvtsi128_si64(total) + (uint64_t) _mm_cvtsi128_si64(_mm_unpackhi_epi64(total, total));
+}
+
+void bcd_digit_histogram_sse2(const packed_BCD_pair *x, size_t n, uintmax_t counts[10])   {
+    const __m128i low = _mm_set1_epi8(0x0F), zero = _mm_setzero_si128();
+    for (size_t start = 0; start < n; start += 127 * 16)    {
+        size_t stop = min(n, start + 127 * 16);
+        __m128i tally[10];
+        for (unsigned char d = 1; d < 10; d++)  {
+            tally[d] = zero;
+        }
+        for (size_t i = start; i < stop; i += 16)   {
+            __m128i v = _mm_loadu_si128((const __m128i *) (x + i));
+            __m128i lo = _mm_and_si128(v, low), hi = _mm_and_si128(_mm_srli_epi16(v, 4), low);
+            for (unsigned char d = 1; d < 10; d++)  {
+                __m128i digit = _mm_set1_epi8(d);
+                tally[d] = _mm_sub_epi8(tally[d], _mm_cmpeq_epi8(lo, digit));
+                tally[d] = _mm_sub_epi8(tally[d], _mm_cmpeq_epi8(hi, digit));
+            }
+        }
+        for (unsigned char d = 1; d < 10; d++)  {
+            __m128i sums = _mm_sad_epu8(tally[d], zero);
+            counts[d] += (uint64_t) _mm_cvtsi128_si64(sums) + (uint64_t) _mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums));
+        }
+    }
+}
+#endif
+
+uintmax_t bcd_digit_sum(BCD_int x)  {
+    // returns the sum of the decimal digits of x, ignoring its sign
+    const packed_BCD_pair *digits = bcd_data(&x);
+    size_t i = 0, n = x.bcd_digits;
+    uintmax_t ret = 0;
+#if HAS_X64_SIMD
+    if (n >= 32 && bcd_has_avx2())  {
+        ret += bcd_digit_sum_avx2(digits, n & ~(size_t) 31);
+        i = n & ~(size_t) 31;
+    }
+    if (n - i >= 16)    {
+        ret += bcd_digit_sum_sse2(digits + i, (n - i) & ~(size_t) 15);
+        i += (n - i) & ~(size_t) 15;
+    }
+#endif
+    for (; i < n; i++)  {
+        ret += (digits[i] >> 4) + (digits[i] & 0xF);
+    }
+    return ret;
+}
+
+void bcd_digit_histogram(BCD_int x, uintmax_t counts[10])   {
+    // sets counts[d] to the number of times d appears in x. Zero is counted as the single digit 0
+    // only 1 thru 9 get counted directly. Everything else is a 0, which keeps the leading zero nibble of an odd
+    // length number out of the count
+    const packed_BCD_pair *digits = bcd_data(&x);
+    size_t i = 0, n = x.bcd_digits;
+    uintmax_t nonzero = 0;
+    memset(counts, 0, sizeof(uintmax_t) * 10);
+#if HAS_X64_SIMD
+    if (n >= 32 && bcd_has_avx2())  {
+        bcd_digit_histogram_avx2(digits, n & ~(size_t) 31, counts);
+        i = n & ~(size_t) 31;
+    }
+    if (n - i >= 16)    {
+        bcd_digit_histogram_sse2(digits + i, (n - i) & ~(size_t) 15, counts);
+        i += (n - i) & ~(size_t) 15;
+    }
+#endif
+    for (; i < n; i++)  {
+        counts[digits[i] >> 4]++;
+        counts[digits[i] & 0xF]++;
+    }
+    for (unsigned char d = 1; d < 10; d++)  {
+        nonzero += counts[d];
+    }
+    counts[0] = x.zero ? 1 : x.decimal_digits - nonzero;
+}
+
+BCD_int reverse_bcd(BCD_int x)  {
+    // returns x with its decimal digits in the opposite order, keeping its sign. Trailing zeros of x vanish
     if (unlikely(x.zero))   {
-        printf("0");
-        return;
+        // x might still hold a heap buffer, so hand back a fresh zero rather than a second owner of it
+        return new_BCD_int(0, false);
+    }
+    BCD_int ret = x;
+    const packed_BCD_pair *digits = bcd_data(&x);
+    packed_BCD_pair *out = bcd_init_digits(&ret, x.bcd_digits);
+    size_t i = 0, n = x.bcd_digits;
+    bool odd = x.decimal_digits % 2;
+#if HAS_X64_SIMD
+    if (bcd_has_avx2()) {
+        i = bcd_reverse_bytes_avx2(out, digits, n, odd);
     }
-    if (x.negative) {
-        printf("-");
+    for (; i + 16 + odd <= n; i += 16)  {
+        _mm_storeu_si128((__m128i *) (out + i), bcd_mirror_sse2(digits, n, i, odd));
     }
-    size_t i = x.bcd_digits - 1;
-    printf("%x", x.digits[i]);
-    if (i--)    {
-        for (; i != -1; i--)  {
-            printf("%02x", x.digits[i]);
+#endif
+    for (; i < n; i++)  {
+        out[i] = bcd_mirror_scalar(digits, n, i, odd);
+    }
+    normalize_bcd(&ret);
+    ret.negative = x.negative;
+    return ret;
+}
+
+bool is_bcd_palindrome(BCD_int x)   {
+    // checks if x reads the same in both directions, ignoring its sign, by comparing it against its own reversal
+    // each half gets compared against the other, so this stops at the middle, or at the first mismatch
+    const packed_BCD_pair *digits = bcd_data(&x);
+    size_t i = 0, n = x.bcd_digits, half = (n + 1) / 2;
+    bool odd = x.decimal_digits % 2;
+#if HAS_X64_SIMD
+    if (bcd_has_avx2() && !bcd_mirror_match_avx2(digits, n, half, odd, &i)) {
+        return false;
+    }
+    for (; i < half && i + 16 + odd <= n; i += 16)  {
+        __m128i v = _mm_loadu_si128((const __m128i *) (digits + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, bcd_mirror_sse2(digits, n, i, odd))) != 0xFFFF)  {
+            return false;
         }
     }
+#endif
+    for (; i < half; i++)   {
+        if (digits[i] != bcd_mirror_scalar(digits, n, i, odd))  {
+            return false;
+        }
+    }
+    return true;
+}
+
+void fprint_bcd_string(FILE *stream, BCD_int x, const char *suffix) {
+    // formats x and suffix into one buffer, so the whole thing goes out in a single write
+    char small[256], *buf = small;
+    size_t suffix_len = strlen(suffix), size = x.decimal_digits + 2 + suffix_len;
+    if (size > sizeof(small))   {
+        buf = (char *) bcd_alloc(size);
+    }
+    size_t len = bcd_to_chars(x, buf);
+    memcpy(buf + len, suffix, suffix_len);
+    fwrite(buf, 1, len + suffix_len, stream);
+    if (buf != small)   {
+        bcd_release(buf, size);
+    }
+}
+
+void fprint_bcd(FILE *stream, BCD_int x);
+inline void fprint_bcd(FILE *stream, BCD_int x) {
+    fprint_bcd_string(stream, x, "");
+}
+
+void fprint_bcd_ln(FILE *stream, BCD_int x);
+inline void fprint_bcd_ln(FILE *stream, BCD_int x)  {
+    fprint_bcd_string(stream, x, "\n");
+}
+
+void print_bcd(BCD_int x);
+inline void print_bcd(BCD_int x)    {
+    fprint_bcd_string(stdout, x, "");
 }
 
 void print_bcd_ln(BCD_int x);
 inline void print_bcd_ln(BCD_int x) {
-    print_bcd(x);
-    printf("\n");
+    fprint_bcd_string(stdout, x, "\n");
 }
+
+#endif
@@ -0,0 +1,639 @@
+#ifndef BIGINT_H
+#define BIGINT_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "macros.h"
+#include "math.h"
+#include "bcd.h"
+
+#if !PCC_COMPILER
+    #include <stdlib.h>
+#endif
+
+#ifndef BIGINT_KARATSUBA_THRESHOLD
+    // below this many limbs, schoolbook multiplication beats the bookkeeping of Karatsuba
+    #define BIGINT_KARATSUBA_THRESHOLD 32
+#endif
+
+#ifndef BIGINT_RADIX_THRESHOLD
+    // below this many limbs, decimal conversion is done directly instead of by divide and conquer
+    #define BIGINT_RADIX_THRESHOLD 16
+#endif
+
+#define BIGINT_RADIX_BCD_THRESHOLD (BIGINT_RADIX_THRESHOLD * 8)
+#define BIGINT_POW_10_18 1000000000000000000ULL
+
+typedef struct {
+    // a little-endian, arbitrary-precision, binary integer made of 64-bit limbs
+    // like BCD_int, every operation returns a new value, which the caller must free
+    uint64_t *limbs;
+    size_t len;  // the number of limbs in use, so the top limb is never 0
+    bool negative : 1;
+    bool zero : 1;
+} bigint;
+
+// the limbs_* functions work on raw little-endian limb arrays, and are the building blocks for the bigint ones
+
+size_t limbs_trim(const uint64_t *a, size_t len);
+inline size_t limbs_trim(const uint64_t *a, size_t len)    {
+    // returns the length of a once leading zero limbs are removed
+    while (len && !a[len - 1])  {
+        len--;
+    }
+    return len;
+}
+
+signed char limbs_cmp(const uint64_t *a, size_t a_len, const uint64_t *b, size_t b_len)    {
+    // compares two trimmed limb arrays, returning 1 if a > b, -1 if b > a, else 0
+    if (a_len != b_len) {
+        return (a_len > b_len) ? 1 : -1;
+    }
+    for (size_t i = a_len - 1; i != -1; i--)    {
+        if (a[i] != b[i])   {
+            return (a[i] > b[i]) ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+uint64_t limbs_add(uint64_t *out, const uint64_t *a, size_t a_len, const uint64_t *b, size_t b_len)    {
+    // writes the low a_len limbs of a + b to out and returns the carry. a_len must be at least b_len
+    // out may be the same array as a
+    uint64_t carry = 0;
+    size_t i;
+    for (i = 0; i < b_len; i++) {
+        uint64_t sum = a[i] + carry;
+        carry = (sum < carry);
+        sum += b[i];
+        carry += (sum < b[i]);
+        out[i] = sum;
+    }
+    for (; i < a_len; i++)  {
+        out[i] = a[i] + carry;
+        carry = carry && !out[i];
+    }
+    return carry;
+}
+
+uint64_t limbs_sub(uint64_t *out, const uint64_t *a, size_t a_len, const uint64_t *b, size_t b_len)    {
+    // writes the low a_len limbs of a - b to out and returns the borrow. a_len must be at least b_len
+    // out may be the same array as a
+    uint64_t borrow = 0;
+    size_t i;
+    for (i = 0; i < b_len; i++) {
+        uint64_t diff = a[i] - b[i];
+        uint64_t next_borrow = (diff > a[i]);
+        next_borrow += (diff < borrow);
+        out[i] = diff - borrow;
+        borrow = next_borrow;
+    }
+    for (; i < a_len; i++)  {
+        uint64_t limb = a[i];
+        out[i] = limb - borrow;
+        borrow = borrow && !limb;
+    }
+    return borrow;
+}
+
+uint64_t limbs_mul_1_add(uint64_t *a, size_t len, uint64_t m, uint64_t add)    {
+    // replaces a with a * m + add in place, and returns the limb that carried out the top
+    for (size_t i = 0; i < len; i++)    {
+        uint64_t hi, lo = mul_64x64(a[i], m, &hi);
+        lo += add;
+        hi += (lo < add);
+        a[i] = lo;
+        add = hi;
+    }
+    return add;
+}
+
+uint64_t limbs_divmod_1(uint64_t *q, const uint64_t *a, size_t len, uint64_t d) {
+    // writes a / d to q and returns a % d. q may be the same array as a
+    uint64_t r = 0;
+    for (size_t i = len - 1; i != -1; i--)  {
+        q[i] = div_128_64(r, a[i], d, &r);
+    }
+    return r;
+}
+
+void limbs_mul_schoolbook(uint64_t *out, const uint64_t *a, size_t a_len, const uint64_t *b, size_t b_len)   {
+    // writes the a_len + b_len limb product of a and b to out. this takes O(a_len * b_len) time
+    memset(out, 0, sizeof(uint64_t) * (a_len + b_len));
+    for (size_t i = 0; i < a_len; i++)  {
+        uint64_t carry = 0, *row = out + i;
+        for (size_t j = 0; j < b_len; j++)  {
+            uint64_t hi, lo = mul_64x64(a[i], b[j], &hi);
+            lo += carry;
+            hi += (lo < carry);
+            row[j] += lo;
+            hi += (row[j] < lo);
+            carry = hi;
+        }
+        row[b_len] = carry;
+    }
+}
+
+void limbs_mul_karatsuba(uint64_t *out, const uint64_t *a, const uint64_t *b, size_t n, uint64_t *scratch)  {
+    // writes the 2n limb product of two n limb numbers to out, using at most 8n + 1024 limbs of scratch
+    // with a = a1 * B^h + a0 and b = b1 * B^h + b0, the middle term a1b0 + a0b1 is (a0 + a1)(b0 + b1) - a0b0 - a1b1
+    if (n <= BIGINT_KARATSUBA_THRESHOLD)    {
+        limbs_mul_schoolbook(out, a, n, b, n);
+        return;
+    }
+    size_t h = n / 2, k = n - h;
+    uint64_t *a_sum = scratch, *b_sum = scratch + k + 1, *mid = scratch + 2 * k + 2, *rest = scratch + 4 * k + 4;
+    limbs_mul_karatsuba(out, a, b, h, rest);
+    limbs_mul_karatsuba(out + 2 * h, a + h, b + h, k, rest);
+    a_sum[k] = limbs_add(a_sum, a + h, k, a, h);
+    b_sum[k] = limbs_add(b_sum, b + h, k, b, h);
+    limbs_mul_karatsuba(mid, a_sum, b_sum, k + 1, rest);
+    limbs_sub(mid, mid, 2 * k + 2, out, 2 * h);
+    limbs_sub(mid, mid, 2 * k + 2, out + 2 * h, 2 * k);
+    limbs_add(out + h, out + h, h + 2 * k, mid, limbs_trim(mid, 2 * k + 2));
+}
+
+void limbs_mul(uint64_t *out, const uint64_t *a, size_t a_len, const uint64_t *b, size_t b_len)  {
+    // writes the a_len + b_len limb product of a and b to out, picking schoolbook or Karatsuba multiplication
+    if (a_len < b_len)  {
+        const uint64_t *tmp = a;
+        a = b;
+        b = tmp;
+        size_t tmp_len = a_len;
+        a_len = b_len;
+        b_len = tmp_len;
+    }
+    if (b_len <= BIGINT_KARATSUBA_THRESHOLD)    {
+        limbs_mul_schoolbook(out, a, a_len, b, b_len);
+        return;
+    }
+    // multiply b by each b_len limb block of a, so that every Karatsuba call is balanced
+    uint64_t *block = (uint64_t *) malloc(sizeof(uint64_t) * 2 * b_len);
+    uint64_t *padded = (uint64_t *) calloc(b_len, sizeof(uint64_t));
+    uint64_t *scratch = (uint64_t *) malloc(sizeof(uint64_t) * (8 * b_len + 1024));
+    memset(out, 0, sizeof(uint64_t) * (a_len + b_len));
+    for (size_t start = 0; start < a_len; start += b_len)   {
+        const uint64_t *chunk = a + start;
+        size_t remaining = a_len + b_len - start;
+        if (a_len - start < b_len)  {
+            memcpy(padded, chunk, sizeof(uint64_t) * (a_len - start));
+            chunk = padded;
+        }
+        limbs_mul_karatsuba(block, chunk, b, b_len, scratch);
+        limbs_add(out + start, out + start, remaining, block, min(2 * b_len, remaining));
+    }
+    free(block);
+    free(padded);
+    free(scratch);
+}
+
+void limbs_divmod(uint64_t *q, uint64_t *r, const uint64_t *a, size_t a_len, const uint64_t *b, size_t b_len) {
+    // writes the a_len - b_len + 1 limbs of a / b to q, and the b_len limbs of a % b to r, using Knuth's algorithm D
+    // both a and b must be trimmed, and a_len must be at least b_len
+    if (b_len == 1) {
+        r[0] = limbs_divmod_1(q, a, a_len, b[0]);
+        return;
+    }
+    unsigned char s = clz64(b[b_len - 1]);
+    uint64_t *u = (uint64_t *) malloc(sizeof(uint64_t) * (a_len + 1));
+    uint64_t *v = (uint64_t *) malloc(sizeof(uint64_t) * b_len);
+    size_t i, j;
+    // normalize, so that the top limb of v has its high bit set and each quotient estimate is off by at most 2
+    for (i = b_len - 1; i; i--) {
+        v[i] = (b[i] << s) | (s ? b[i - 1] >> (64 - s) : 0);
+    }
+    v[0] = b[0] << s;
+    u[a_len] = s ? a[a_len - 1] >> (64 - s) : 0;
+    for (i = a_len - 1; i; i--) {
+        u[i] = (a[i] << s) | (s ? a[i - 1] >> (64 - s) : 0);
+    }
+    u[0] = a[0] << s;
+    const uint64_t v_top = v[b_len - 1], v_next = v[b_len - 2];
+    for (j = a_len - b_len; j != -1; j--)   {
+        uint64_t q_hat, r_hat, hi, lo, carry = 0, borrow = 0;
+        bool r_hat_overflow = false;
+        if (u[j + b_len] >= v_top)  {
+            q_hat = UINT64_MAX;
+            r_hat = u[j + b_len - 1] + v_top;
+            r_hat_overflow = (r_hat < v_top);
+        }
+        else    {
+            q_hat = div_128_64(u[j + b_len], u[j + b_len - 1], v_top, &r_hat);
+        }
+        while (!r_hat_overflow) {
+            lo = mul_64x64(q_hat, v_next, &hi);
+            if (hi < r_hat || (hi == r_hat && lo <= u[j + b_len - 2]))  {
+                break;
+            }
+            q_hat--;
+            r_hat += v_top;
+            r_hat_overflow = (r_hat < v_top);
+        }
+        // subtract q_hat * v from the current window of u
+        for (i = 0; i < b_len; i++) {
+            lo = mul_64x64(q_hat, v[i], &hi);
+            lo += carry;
+            hi += (lo < carry);
+            carry = hi;
+            uint64_t diff = u[i + j] - lo;
+            uint64_t next_borrow = (diff > u[i + j]);
+            next_borrow += (diff < borrow);
+            u[i + j] = diff - borrow;
+            borrow = next_borrow;
+        }
+        uint64_t top = u[j + b_len] - carry;
+        bool negative = (top > u[j + b_len]) || (top < borrow);
+        u[j + b_len] = top - borrow;
+        if (negative)   {  // q_hat was one too big, which happens with probability around 2 / 2^64
+            q_hat--;
+            u[j + b_len] += limbs_add(u + j, u + j, b_len, v, b_len);
+        }
+        q[j] = q_hat;
+    }
+    for (i = 0; i < b_len - 1; i++) {
+        r[i] = (u[i] >> s) | (s ? u[i + 1] << (64 - s) : 0);
+    }
+    r[b_len - 1] = u[b_len - 1] >> s;
+    free(u);
+    free(v);
+}
+
+bigint bigint_from_limbs(uint64_t *limbs, size_t len, bool negative)    {
+    // wraps a malloc'd limb array in a bigint, taking ownership of it
+    bigint ret;
+    ret.len = limbs_trim(limbs, len);
+    ret.zero = !ret.len;
+    ret.negative = negative && !ret.zero;
+    if (ret.zero)   {
+        free(limbs);
+        limbs = NULL;
+    }
+    ret.limbs = limbs;
+    return ret;
+}
+
+bigint new_bigint(uintmax_t a, bool negative)   {
+    size_t len = 0;
+    uint64_t *limbs = (uint64_t *) malloc(sizeof(uintmax_t) > 8 ? sizeof(uintmax_t) : 8);
+    while (a)   {
+        limbs[len++] = (uint64_t) a;
+        a = (a >> 63) >> 1;  // two steps, so this is never a shift by the full width of uintmax_t
+    }
+    return bigint_from_limbs(limbs, len, negative);
+}
+
+void free_bigint(bigint x);
+inline void free_bigint(bigint x)   {
+    free(x.limbs);
+}
+
+bigint copy_bigint(bigint a);
+inline bigint copy_bigint(bigint a) {
+    bigint b = a;
+    if (!a.zero)    {
+        b.limbs = (uint64_t *) malloc(sizeof(uint64_t) * a.len);
+        memcpy(b.limbs, a.limbs, sizeof(uint64_t) * a.len);
+    }
+    return b;
+}
+
+signed char cmp_bigint(bigint x, bigint y)  {
+    // returns:
+    // 1 if x > y
+    // -1 if y > x
+    // else 0
+    if (x.negative != y.negative)   {
+        return (x.negative) ? -1 : 1;
+    }
+    signed char ret = limbs_cmp(x.limbs, x.len, y.limbs, y.len);
+    return (x.negative) ? -ret : ret;
+}
+
+bigint add_bigint_magnitudes(bigint x, bigint y, bool negative, bool subtract)  {
+    // returns |x| + |y|, or ||x| - |y|| if subtract is set, with the given sign, flipped if |y| > |x|
+    if (limbs_cmp(x.limbs, x.len, y.limbs, y.len) < 0)  {
+        bigint tmp = x;
+        x = y;
+        y = tmp;
+        negative = negative != subtract;
+    }
+    uint64_t *limbs = (uint64_t *) malloc(sizeof(uint64_t) * (x.len + 1));
+    if (subtract)   {
+        limbs_sub(limbs, x.limbs, x.len, y.limbs, y.len);
+        limbs[x.len] = 0;
+    }
+    else    {
+        limbs[x.len] = limbs_add(limbs, x.limbs, x.len, y.limbs, y.len);
+    }
+    return bigint_from_limbs(limbs, x.len + 1, negative);
+}
+
+bigint add_bigint(bigint x, bigint y)   {
+    // performing this on two n-limb numbers will take O(n) time
+    return add_bigint_magnitudes(x, y, x.negative, x.negative != y.negative);
+}
+
+bigint sub_bigint(bigint x, bigint y)   {
+    // performing this on two n-limb numbers will take O(n) time
+    return add_bigint_magnitudes(x, y, x.negative, x.negative == y.negative);
+}
+
+bigint mul_bigint(bigint x, bigint y)   {
+    // this takes O(log(x) * log(y)) time for small or lopsided numbers, and O(log(max(x, y))^1.585) past
+    // BIGINT_KARATSUBA_THRESHOLD limbs
+    if (unlikely(x.zero || y.zero)) {
+        return new_bigint(0, false);
+    }
+    uint64_t *limbs = (uint64_t *) malloc(sizeof(uint64_t) * (x.len + y.len));
+    limbs_mul(limbs, x.limbs, x.len, y.limbs, y.len);
+    return bigint_from_limbs(limbs, x.len + y.len, x.negative != y.negative);
+}
+
+void divmod_bigint(bigint x, bigint y, bigint *quotient, bigint *remainder)    {
+    // computes x / y, rounded towards zero, and the remainder, which takes the sign of x, like C's / and %
+    // either output can be NULL if you don't need it. y must be non-zero
+    bigint q, r;
+    if (limbs_cmp(x.limbs, x.len, y.limbs, y.len) < 0)  {
+        q = new_bigint(0, false);
+        r = copy_bigint(x);
+    }
+    else    {
+        uint64_t *q_limbs = (uint64_t *) malloc(sizeof(uint64_t) * (x.len - y.len + 1));
+        uint64_t *r_limbs = (uint64_t *) malloc(sizeof(uint64_t) * y.len);
+        limbs_divmod(q_limbs, r_limbs, x.limbs, x.len, y.limbs, y.len);
+        q = bigint_from_limbs(q_limbs, x.len - y.len + 1, x.negative != y.negative);
+        r = bigint_from_limbs(r_limbs, y.len, x.negative);
+    }
+    if (quotient != NULL)   {
+        *quotient = q;
+    }
+    else    {
+        free_bigint(q);
+    }
+    if (remainder != NULL)  {
+        *remainder = r;
+    }
+    else    {
+        free_bigint(r);
+    }
+}
+
+bigint div_bigint(bigint x, bigint y);
+inline bigint div_bigint(bigint x, bigint y)    {
+    bigint ret;
+    divmod_bigint(x, y, &ret, NULL);
+    return ret;
+}
+
+bigint mod_bigint(bigint x, bigint y);
+inline bigint mod_bigint(bigint x, bigint y)    {
+    bigint ret;
+    divmod_bigint(x, y, NULL, &ret);
+    return ret;
+}
+
+#ifndef BIGINT_PRODUCT_THRESHOLD
+    // below this many factors, product_bigint_words() multiplies them in one at a time instead of splitting
+    #define BIGINT_PRODUCT_THRESHOLD 16
+#endif
+
+bigint product_bigint_words(const uint64_t *words, size_t len)   {
+    // returns the product of len machine words, which is 1 if len is 0
+    // the list is split in half until it's short, so the big multiplications are always between balanced halves,
+    // which is what lets Karatsuba pay off when multiplying out long lists like factorials or binomials
+    if (len <= BIGINT_PRODUCT_THRESHOLD)    {
+        uint64_t *limbs = (uint64_t *) malloc(sizeof(uint64_t) * (len + 1));
+        size_t limbs_len = 1;
+        limbs[0] = 1;
+        for (size_t i = 0; i < len; i++)    {
+            uint64_t carry = limbs_mul_1_add(limbs, limbs_len, words[i], 0);
+            if (carry)  {
+                limbs[limbs_len++] = carry;
+            }
+        }
+        return bigint_from_limbs(limbs, limbs_len, false);
+    }
+    bigint low = product_bigint_words(words, len / 2), high = product_bigint_words(words + len / 2, len - len / 2);
+    bigint ret = mul_bigint(low, high);
+    free_bigint(low);
+    free_bigint(high);
+    return ret;
+}
+
+bigint pow_bigint(bigint x, uintmax_t y)    {
+    // this takes O(log(y)) multiplications, by squaring for each bit of y from the top down
+    bigint answer = new_bigint(1, false), tmp;
+    uintmax_t mask = ~(UINTMAX_MAX >> 1);
+    for (; mask && !(y & mask); mask >>= 1);
+    for (; mask; mask >>= 1)    {
+        tmp = mul_bigint(answer, answer);
+        free_bigint(answer);
+        answer = tmp;
+        if (y & mask)   {
+            tmp = mul_bigint(answer, x);
+            free_bigint(answer);
+            answer = tmp;
+        }
+    }
+    return answer;
+}
+
+bigint pow_mod_bigint(bigint x, bigint y, bigint m) {
+    // returns x^y mod |m|, in the range [0, |m|), which takes O(log(y)) multiplications and reductions
+    // y must not be negative, and m must be non-zero
+    bigint base = mod_bigint(x, m), answer = new_bigint(1, false), tmp;
+    m.negative = false;
+    if (base.negative)  {
+        tmp = add_bigint(base, m);
+        free_bigint(base);
+        base = tmp;
+    }
+    tmp = mod_bigint(answer, m);  // in case m is 1
+    free_bigint(answer);
+    answer = tmp;
+    for (size_t i = y.len - 1; i != -1; i--)    {
+        unsigned char bit = (i == y.len - 1) ? 63 - clz64(y.limbs[i]) : 63;
+        for (; bit != (unsigned char) -1; bit--)    {
+            tmp = mul_bigint(answer, answer);
+            free_bigint(answer);
+            answer = mod_bigint(tmp, m);
+            free_bigint(tmp);
+            if ((y.limbs[i] >> bit) & 1)    {
+                tmp = mul_bigint(answer, base);
+                free_bigint(answer);
+                answer = mod_bigint(tmp, m);
+                free_bigint(tmp);
+            }
+        }
+    }
+    free_bigint(base);
+    return answer;
+}
+
+// decimal conversion splits the number in half around a precomputed power of the other radix, converts both
+// halves, then recombines them with one multiplication. powers[k] always splits off BIGINT_RADIX_THRESHOLD << k
+// limbs (or BIGINT_RADIX_BCD_THRESHOLD << k packed bytes), and each is the square of the last, so with Karatsuba
+// underneath this takes O(n^1.585) time instead of the O(n^2) of repeated short division
+
+BCD_int bcd_from_limbs_small(const uint64_t *limbs, size_t len) {
+    // converts a short limb array to BCD by peeling off 18 decimal digits, which is 9 packed bytes, at a time
+    len = limbs_trim(limbs, len);
+    if (!len)   {
+        return new_BCD_int(0, false);
+    }
+    uint64_t *tmp = (uint64_t *) malloc(sizeof(uint64_t) * len);
+    // each limb holds fewer than 20 decimal digits, so there are at most 2 chunks of 18 per limb
+    unsigned char *bytes = (unsigned char *) malloc(9 * 2 * len);
+    size_t count = 0;
+    memcpy(tmp, limbs, sizeof(uint64_t) * len);
+    while (len) {
+        uint64_t chunk = limbs_divmod_1(tmp, tmp, len, BIGINT_POW_10_18);
+        len = limbs_trim(tmp, len);
+        for (unsigned char i = 0; i < 9; i++, chunk /= 100)  {
+            bytes[count++] = (((chunk % 100) / 10) << 4) | (chunk % 10);
+        }
+    }
+    BCD_int ret = BCD_from_bytes(bytes, count, false, true);
+    free(tmp);
+    free(bytes);
+    return ret;
+}
+
+BCD_int bcd_from_limbs_recursive(const uint64_t *limbs, size_t len, BCD_int *powers, size_t *built)  {
+    len = limbs_trim(limbs, len);
+    if (len <= BIGINT_RADIX_THRESHOLD)  {
+        return bcd_from_limbs_small(limbs, len);
+    }
+    size_t k = 0, h;
+    while ((BIGINT_RADIX_THRESHOLD << (k + 1)) < len)  {
+        k++;
+    }
+    h = BIGINT_RADIX_THRESHOLD << k;
+    for (; *built <= k; (*built)++) {
+        powers[*built] = mul_bcd(powers[*built - 1], powers[*built - 1]);
+    }
+    BCD_int high = bcd_from_limbs_recursive(limbs + h, len - h, powers, built);
+    BCD_int low = bcd_from_limbs_recursive(limbs, h, powers, built);
+    BCD_int shifted = mul_bcd(high, powers[k]);
+    BCD_int ret = add_bcd(shifted, low);
+    free_BCD_int(high);
+    free_BCD_int(low);
+    free_BCD_int(shifted);
+    return ret;
+}
+
+BCD_int bcd_from_bigint(bigint x)   {
+    // converts a bigint to a BCD_int, which is how you get at its decimal digits
+    if (x.zero) {
+        return new_BCD_int(0, false);
+    }
+    BCD_int powers[64], ret;
+    size_t built = 1;
+    if (x.len > BIGINT_RADIX_THRESHOLD) {
+        // powers[0] is 2^(64 * BIGINT_RADIX_THRESHOLD)
+        uint64_t one[BIGINT_RADIX_THRESHOLD + 1] = {0};
+        one[BIGINT_RADIX_THRESHOLD] = 1;
+        powers[0] = bcd_from_limbs_small(one, BIGINT_RADIX_THRESHOLD + 1);
+        ret = bcd_from_limbs_recursive(x.limbs, x.len, powers, &built);
+        for (size_t i = 0; i < built; i++)  {
+            free_BCD_int(powers[i]);
+        }
+    }
+    else    {
+        ret = bcd_from_limbs_small(x.limbs, x.len);
+    }
+    ret.negative = x.negative;
+    return ret;
+}
+
+bigint bigint_from_bcd_small(const packed_BCD_pair *digits, size_t len) {
+    // converts a short run of packed bytes to a bigint by Horner's method, taking 9 bytes (18 digits) at a time
+    uint64_t *limbs = (uint64_t *) malloc(sizeof(uint64_t) * (len / 9 + 2));
+    size_t limbs_len = 0;
+    for (size_t i = len; i; )   {
+        uint64_t chunk = 0, scale = 1;
+        for (unsigned char j = 0; j < 9 && i; j++, scale *= 100) {
+            packed_BCD_pair pair = digits[--i];
+            chunk = chunk * 100 + (pair >> 4) * 10 + (pair & 0xF);
+        }
+        uint64_t carry = limbs_mul_1_add(limbs, limbs_len, scale, chunk);
+        if (carry)  {
+            limbs[limbs_len++] = carry;
+        }
+    }
+    return bigint_from_limbs(limbs, limbs_len, false);
+}
+
+bigint bigint_from_bcd_recursive(const packed_BCD_pair *digits, size_t len, bigint *powers, size_t *built)    {
+    if (len <= BIGINT_RADIX_BCD_THRESHOLD)  {
+        return bigint_from_bcd_small(digits, len);
+    }
+    size_t k = 0, h;
+    while ((BIGINT_RADIX_BCD_THRESHOLD << (k + 1)) < len)  {
+        k++;
+    }
+    h = BIGINT_RADIX_BCD_THRESHOLD << k;
+    for (; *built <= k; (*built)++) {
+        powers[*built] = mul_bigint(powers[*built - 1], powers[*built - 1]);
+    }
+    bigint high = bigint_from_bcd_recursive(digits + h, len - h, powers, built);
+    bigint low = bigint_from_bcd_recursive(digits, h, powers, built);
+    bigint shifted = mul_bigint(high, powers[k]);
+    bigint ret = add_bigint(shifted, low);
+    free_bigint(high);
+    free_bigint(low);
+    free_bigint(shifted);
+    return ret;
+}
+
+bigint bigint_from_bcd(BCD_int x)   {
+    // converts a BCD_int to a bigint, so that further arithmetic can skip decimal adjustment
+    if (x.zero) {
+        return new_bigint(0, false);
+    }
+    bigint powers[64], ret;
+    size_t built = 1;
+    if (x.bcd_digits > BIGINT_RADIX_BCD_THRESHOLD)  {
+        // powers[0] is 100^BIGINT_RADIX_BCD_THRESHOLD
+        packed_BCD_pair one[BIGINT_RADIX_BCD_THRESHOLD + 1] = {0};
+        one[BIGINT_RADIX_BCD_THRESHOLD] = 1;
+        powers[0] = bigint_from_bcd_small(one, BIGINT_RADIX_BCD_THRESHOLD + 1);
+        ret = bigint_from_bcd_recursive(bcd_data(&x), x.bcd_digits, powers, &built);
+        for (size_t i = 0; i < built; i++)  {
+            free_bigint(powers[i]);
+        }
+    }
+    else    {
+        ret = bigint_from_bcd_small(bcd_data(&x), x.bcd_digits);
+    }
+    ret.negative = x.negative && !ret.zero;
+    return ret;
+}
+
+BCD_int pow_mod_bcd(BCD_int x, BCD_int y, BCD_int m)   {
+    // returns x^y mod |m|, in the range [0, |m|), by way of pow_mod_bigint(), since reductions are far cheaper there
+    bigint bx = bigint_from_bcd(x), by = bigint_from_bcd(y), bm = bigint_from_bcd(m);
+    bigint answer = pow_mod_bigint(bx, by, bm);
+    BCD_int ret = bcd_from_bigint(answer);
+    free_bigint(bx);
+    free_bigint(by);
+    free_bigint(bm);
+    free_bigint(answer);
+    return ret;
+}
+
+void print_bigint(bigint x) {
+    BCD_int tmp = bcd_from_bigint(x);
+    print_bcd(tmp);
+    free_BCD_int(tmp);
+}
+
+void print_bigint_ln(bigint x);
+inline void print_bigint_ln(bigint x)   {
+    print_bigint(x);
+    printf("\n");
+}
+
+#endif
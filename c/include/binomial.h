@@ -0,0 +1,293 @@
+#ifndef BINOMIAL_H
+#define BINOMIAL_H
+
+#include "macros.h"
+#include "math.h"
+#include "primes.h"
+#include "bigint.h"
+
+#if !PCC_COMPILER
+    #include <stdlib.h>
+#endif
+
+uintmax_t binomial_prime_exponent(uintmax_t n, uintmax_t r, uintmax_t p)    {
+    /**
+     * Finds the exponent of the prime p in C(n, r), by Kummer's theorem
+     * @n: The size of the set being chosen from
+     * @r: The number of items chosen, which must be at most n
+     * @p: The prime you want the exponent of
+     *
+     * The exponent is the number of carries when adding r and n - r in base p, which is the same count Legendre's
+     * formula gives, without needing any of the factorials
+     */
+    uintmax_t m = n - r, ret = 0;
+    bool carry = false;
+    for (; r || m || carry; r /= p, m /= p) {
+        carry = (r % p + m % p + carry >= p);
+        ret += carry;
+    }
+    return ret;
+}
+
+#if HAS_INT128
+unsigned __int128 binomial_u128(uintmax_t n, uintmax_t r)    {
+    /**
+     * Computes C(n, r) exactly in 128 bits, returning -1 if it doesn't fit
+     * @n: The size of the set being chosen from
+     * @r: The number of items chosen
+     *
+     * This builds up C(n - r + i, i) one step at a time. Dividing out gcd(answer, i) first leaves a divisor that must
+     * divide n - r + i, so no intermediate is ever bigger than the answer
+     */
+    unsigned __int128 ret = 1;
+    if (r > n)  {
+        return 0;
+    }
+    r = min(r, n - r);
+    for (uintmax_t i = 1; i <= r; i++)  {
+        uintmax_t g = gcd((uint64_t) (ret % i), i), factor = (n - r + i) / (i / g);
+        ret /= g;
+        if (ret > ((unsigned __int128) -1) / factor)    {
+            return -1;
+        }
+        ret *= factor;
+    }
+    return ret;
+}
+#endif
+
+bigint binomial_bigint(uintmax_t n, uintmax_t r)    {
+    /**
+     * Computes C(n, r) exactly, however large it is
+     * @n: The size of the set being chosen from
+     * @r: The number of items chosen
+     *
+     * Each prime up to n contributes p^e, with e from binomial_prime_exponent(), so there's no division at all. The
+     * prime powers are packed into as few machine words as possible, then multiplied out by product_bigint_words().
+     * This sieves every prime up to n, so it's best when r isn't tiny compared to n. The caller is responsible for
+     * freeing the result
+     *
+     * See binomial_prime_exponent, product_bigint_words
+     */
+    if (r > n)  {
+        return new_bigint(0, false);
+    }
+    r = min(r, n - r);
+    size_t len = 0, size = 64;
+    uint64_t *words = (uint64_t *) malloc(sizeof(uint64_t) * size), word = 1;
+    prime_sieve ps = prime_sieve0();
+    for (uintmax_t p = next(ps); p <= n && r; p = next(ps)) {
+        for (uintmax_t e = binomial_prime_exponent(n, r, p); e; e--)    {
+            if (word > UINT64_MAX / p)  {
+                if (len == size)    {
+                    size *= 2;
+                    words = (uint64_t *) realloc(words, sizeof(uint64_t) * size);
+                }
+                words[len++] = word;
+                word = 1;
+            }
+            word *= p;
+        }
+    }
+    free_prime_sieve(ps);
+    if (len == size)    {
+        words = (uint64_t *) realloc(words, sizeof(uint64_t) * (size + 1));
+    }
+    words[len++] = word;
+    bigint ret = product_bigint_words(words, len);
+    free(words);
+    return ret;
+}
+
+typedef struct binomial_mod_table binomial_mod_table;
+struct binomial_mod_table   {
+    /**
+     * The precomputed state for taking binomial coefficients mod a prime power, by Granville's extension of Lucas'
+     * theorem
+     * @p: The prime
+     * @k: The power of p
+     * @modulus: p^k
+     * @unit_factorials: Entry x holds the product of every number from 1 thru x that p doesn't divide, mod p^k, for x
+     * up to p^k
+     *
+     * This takes p^k + 1 words, so it suits moduli up to the tens of millions. With k = 1, it's just Lucas' theorem
+     */
+    uint64_t p;
+    unsigned char k;
+    uint64_t modulus;
+    uint64_t *unit_factorials;
+};
+
+binomial_mod_table binomial_mod_table2(uint64_t p, unsigned char k)    {
+    /**
+     * The constructor for the binomial_mod_table struct
+     * @p: The prime
+     * @k: The power of p, which must be at least 1
+     *
+     * See binomial_mod_table
+     */
+    binomial_mod_table ret;
+    ret.p = p;
+    ret.k = k;
+    ret.modulus = 1;
+    for (unsigned char i = 0; i < k; i++)   {
+        ret.modulus *= p;
+    }
+    ret.unit_factorials = (uint64_t *) malloc(sizeof(uint64_t) * (ret.modulus + 1));
+    ret.unit_factorials[0] = 1;
+    for (uint64_t x = 1; x <= ret.modulus; x++) {
+        ret.unit_factorials[x] = (x % p) ? mul_mod(ret.unit_factorials[x - 1], x % ret.modulus, ret.modulus)
+                                         : ret.unit_factorials[x - 1];
+    }
+    return ret;
+}
+
+void free_binomial_mod_table(binomial_mod_table table);
+inline void free_binomial_mod_table(binomial_mod_table table)    {
+    free(table.unit_factorials);
+}
+
+uint64_t binomial_mod_unit_part(const binomial_mod_table *table, uintmax_t n)   {
+    /**
+     * Computes n! with every factor of p removed, mod p^k
+     * @table: The table for p^k
+     * @n: The number whose factorial you want
+     *
+     * The numbers up to n that p doesn't divide run through whole blocks of p^k, which each multiply to +-1 by the
+     * generalized Wilson's theorem, then a partial block. The multiples of p are p * (n / p)!, so the rest recurses
+     */
+    uint64_t ret = 1 % table->modulus, full = table->unit_factorials[table->modulus];
+    for (; n > 1; n /= table->p)    {
+        ret = mul_mod(ret, table->unit_factorials[n % table->modulus], table->modulus);
+        if ((n / table->modulus) & 1)   {  // full is +-1, so only the parity of the block count matters
+            ret = mul_mod(ret, full, table->modulus);
+        }
+    }
+    return ret;
+}
+
+uint64_t binomial_mod(const binomial_mod_table *table, uintmax_t n, uintmax_t r)    {
+    /**
+     * Computes C(n, r) mod p^k
+     * @table: The table for p^k
+     * @n: The size of the set being chosen from
+     * @r: The number of items chosen
+     *
+     * C(n, r) = p^e * n!' / (r!' (n - r)!'), where e comes from binomial_prime_exponent() and x!' is x! with the
+     * factors of p taken out. Those are units mod p^k, so they can be inverted, using phi(p^k) = p^(k - 1) * (p - 1)
+     *
+     * See binomial_mod_table, binomial_mod_unit_part
+     */
+    if (r > n)  {
+        return 0;
+    }
+    uintmax_t e = binomial_prime_exponent(n, r, table->p);
+    if (e >= table->k)  {
+        return 0;
+    }
+    uint64_t m = table->modulus, phi = m / table->p * (table->p - 1);
+    uint64_t den = mul_mod(binomial_mod_unit_part(table, r), binomial_mod_unit_part(table, n - r), m);
+    uint64_t ret = mul_mod(binomial_mod_unit_part(table, n), pow_mod(den, phi - 1, m), m);
+    for (; e; e--)  {
+        ret = mul_mod(ret, table->p, m);
+    }
+    return ret;
+}
+
+typedef struct pascal_table pascal_table;
+struct pascal_table {
+    /**
+     * A memoized Pascal's triangle, which grows a row at a time as bigger n are asked for, so repeated queries cost
+     * a lookup each
+     * @values: The rows of the triangle, packed one after another. Row n only stores C(n, 0) thru C(n, n / 2),
+     * since the rest mirrors them, and starts at pascal_row_offset(n)
+     * @rows: The number of rows filled in so far
+     * @capacity: The number of entries values has room for
+     * @modulus: If non-zero, every entry is reduced mod this. Otherwise entries that overflow stick at -1, like
+     * n_choose_r()
+     */
+    uintmax_t *values;
+    uintmax_t rows;
+    size_t capacity;
+    uintmax_t modulus;
+};
+
+size_t pascal_row_offset(uintmax_t n);
+inline size_t pascal_row_offset(uintmax_t n) {
+    // row i takes i / 2 + 1 entries, and the sum of i / 2 over i < n is (n / 2) * ((n - 1) / 2)
+    return n + (n ? (n / 2) * ((n - 1) / 2) : 0);
+}
+
+pascal_table pascal_table1(uintmax_t modulus)  {
+    /**
+     * The constructor for the pascal_table struct
+     * @modulus: The modulus to reduce by, or 0 to keep exact values
+     *
+     * See pascal_table
+     */
+    pascal_table ret;
+    ret.values = NULL;
+    ret.rows = 0;
+    ret.capacity = 0;
+    ret.modulus = modulus;
+    return ret;
+}
+
+void free_pascal_table(pascal_table table);
+inline void free_pascal_table(pascal_table table)  {
+    free(table.values);
+}
+
+void extend_pascal_table(pascal_table *table, uintmax_t rows)   {
+    /**
+     * Fills in the triangle up to, but not including, row number rows
+     * @table: The table to extend
+     * @rows: The number of rows it should have
+     */
+    if (rows <= table->rows)    {
+        return;
+    }
+    size_t needed = pascal_row_offset(rows);
+    if (needed > table->capacity)   {
+        table->capacity = max(needed, table->capacity * 2);
+        table->values = (uintmax_t *) realloc(table->values, sizeof(uintmax_t) * table->capacity);
+    }
+    uintmax_t m = table->modulus;
+    for (uintmax_t n = table->rows; n < rows; n++)  {
+        uintmax_t *row = table->values + pascal_row_offset(n);
+        row[0] = m ? 1 % m : 1;
+        if (!n) {
+            continue;
+        }
+        const uintmax_t *prev = table->values + pascal_row_offset(n - 1);
+        for (uintmax_t r = 1; r <= n / 2; r++)  {
+            // C(n, r) = C(n - 1, r - 1) + C(n - 1, r), where the second might be in the mirrored half
+            uintmax_t a = prev[r - 1], b = prev[min(r, n - 1 - r)];
+            if (m)  {
+                row[r] = (a >= m - b) ? a - (m - b) : a + b;
+            }
+            else    {
+                row[r] = (a > UINTMAX_MAX - b) ? UINTMAX_MAX : a + b;
+            }
+        }
+    }
+    table->rows = rows;
+}
+
+uintmax_t pascal_choose(pascal_table *table, uintmax_t n, uintmax_t r)  {
+    /**
+     * Looks up C(n, r), extending the table if row n isn't there yet
+     * @table: The table to look in
+     * @n: The size of the set being chosen from
+     * @r: The number of items chosen
+     *
+     * See pascal_table
+     */
+    if (r > n)  {
+        return 0;
+    }
+    extend_pascal_table(table, n + 1);
+    return table->values[pascal_row_offset(n) + min(r, n - r)];
+}
+
+#endif
@@ -0,0 +1,417 @@
+#ifndef COLLATZ_H
+#define COLLATZ_H
+
+#include "macros.h"
+#include "math.h"
+#include "parallel_primes.h"
+
+#if !PCC_COMPILER
+    #include <stdlib.h>
+#endif
+#if HAS_X64_SIMD
+    #include <immintrin.h>
+#endif
+
+#ifndef COLLATZ_JUMP_BITS
+    // the number of steps each jump takes, which costs 8 * 2^COLLATZ_JUMP_BITS bytes of jump table
+    #define COLLATZ_JUMP_BITS 16
+#endif
+
+#ifndef COLLATZ_UNIT
+    // the number of starting values a range search worker claims at a time
+    #define COLLATZ_UNIT 65536
+#endif
+
+#ifndef COLLATZ_SEARCH_LANES
+    // if set, range searches go through collatz_length_x4(), which only pays off on CPUs with fast gathers
+    #define COLLATZ_SEARCH_LANES 0
+#endif
+
+#define COLLATZ_MAX_JUMP_BITS 18
+
+// everything here counts chains the way Problem 14 does, by their number of terms, so the chain of 1 has length 1.
+// Steps are taken as n -> n / 2 and n -> (3n + 1) / 2, and the second one counts as two terms, since 3n + 1 is even.
+// Writing n = 2^k * a + b, the next k steps only depend on b, and they take n to 3^c * a + d, where c is how many
+// of them were odd and d is where they take b. So with c and d tabulated for every b < 2^k, one lookup and one
+// multiplication do k steps at once. For k up to 18, 3^c and d both fit in 29 bits, so c, d, and 3^c pack into a
+// single word, and each jump is one load
+
+typedef struct collatz_table collatz_table;
+struct collatz_table    {
+    /**
+     * The memo and jump tables shared by every Collatz function
+     * @lengths: Entry n holds the length of the chain starting at n, for n below len. Entry 0 is 0
+     * @len: The number of entries in lengths, which is at least 2^jump_bits
+     * @jump_bits: The number of steps k that each jump takes
+     * @jump_limit: The point past which a jump might overflow, where single steps take over
+     * @jumps: Entry b packs the first k steps from b. Bits 0 thru 4 hold c, the number of them that are odd, bits 5
+     * thru 33 hold d, where they take b, and the top 30 bits hold 3^c
+     *
+     * The chain lengths below 10^10 never reach 1200, so each entry of lengths fits in 16 bits
+     */
+    uint16_t *lengths;
+    uint64_t len;
+    unsigned char jump_bits;
+    uint64_t jump_limit;
+    uint64_t *jumps;
+};
+
+collatz_table collatz_table2(uint64_t len, unsigned char jump_bits)    {
+    /**
+     * The base constructor for the collatz_table struct
+     * @len: The number of starting values to memoize, which gets rounded up to 2^jump_bits
+     * @jump_bits: The number of steps each jump takes, which is clamped to between 1 and COLLATZ_MAX_JUMP_BITS, since
+     * a jump of 0 steps would never get anywhere
+     *
+     * The lengths are filled in from the bottom up, so each chain only needs stepping until it drops below its start,
+     * which takes a handful of steps on average. Every starting value below 23,035,537,407 stays within 64 bits, so
+     * any table that fits in memory can be filled this way
+     *
+     * See collatz_table
+     */
+    collatz_table ret;
+    uint64_t span, x;
+    ret.jump_bits = max(min(jump_bits, COLLATZ_MAX_JUMP_BITS), 1);
+    span = (uint64_t) 1 << ret.jump_bits;
+    ret.len = max(max(len, span), 2);
+    ret.jumps = (uint64_t *) malloc(sizeof(uint64_t) * span);
+    for (uint64_t b = 0; b < span; b++) {
+        uint64_t c = 0, power = 1;
+        x = b;
+        for (unsigned char i = 0; i < ret.jump_bits; i++)   {
+            if (x & 1)  {
+                x += (x >> 1) + 1;
+                c++;
+                power *= 3;
+            } else  {
+                x >>= 1;
+            }
+        }
+        ret.jumps[b] = c | (x << 5) | (power << 34);
+    }
+    // (a + 1) * 3^k must fit, where a = n / 2^k, so that 3^c * a + d can't overflow
+    // b = 2^k - 1 is odd for all k steps, so its entry holds 3^k
+    ret.jump_limit = (UINT64_MAX / (ret.jumps[span - 1] >> 34)) << ret.jump_bits;
+    ret.lengths = (uint16_t *) malloc(sizeof(uint16_t) * ret.len);
+    ret.lengths[0] = 0;
+    ret.lengths[1] = 1;
+    for (uint64_t n = 2; n < ret.len; n++)  {
+        uint16_t steps = 0;
+        for (x = n; x >= n; )   {
+            if (x & 1)  {
+                x += (x >> 1) + 1;
+                steps += 2;
+            } else  {
+                x >>= 1;
+                steps++;
+            }
+        }
+        ret.lengths[n] = steps + ret.lengths[x];
+    }
+    return ret;
+}
+
+collatz_table collatz_table1(uint64_t len);
+inline collatz_table collatz_table1(uint64_t len)  {
+    /**
+     * The simpler constructor for the collatz_table struct, which jumps COLLATZ_JUMP_BITS steps at a time
+     * @len: The number of starting values to memoize, which gets rounded up to 2^COLLATZ_JUMP_BITS
+     *
+     * See collatz_table
+     */
+    return collatz_table2(len, COLLATZ_JUMP_BITS);
+}
+
+void free_collatz_table(collatz_table table);
+inline void free_collatz_table(collatz_table table)    {
+    free(table.lengths);
+    free(table.jumps);
+}
+
+uint64_t collatz_descend(const collatz_table *table, uint64_t n, uint32_t *length)  {
+    /**
+     * Takes single steps from n until it drops back below jump_limit
+     * @table: The table whose jump_limit you want to get under
+     * @n: The value to start from
+     * @length: The running length, which gets the terms taken added to it
+     *
+     * With 128-bit integers this can't overflow. Without them, returns 0 if a step would pass UINT64_MAX, which
+     * first happens for the chain starting at 23,035,537,407
+     */
+#if HAS_INT128
+    unsigned __int128 x = n;
+#else
+    uint64_t x = n;
+#endif
+    while (x >= table->jump_limit)  {
+        if (x & 1)  {
+#if !HAS_INT128
+            if (x > (UINT64_MAX - 1) / 3 * 2)   {
+                return 0;
+            }
+#endif
+            x += (x >> 1) + 1;
+            *length += 2;
+        } else  {
+            x >>= 1;
+            (*length)++;
+        }
+    }
+    return (uint64_t) x;
+}
+
+uint32_t collatz_length(const collatz_table *table, uint64_t n)  {
+    /**
+     * Finds the length of the chain starting at n
+     * @table: The tables to look things up in
+     * @n: The starting value
+     *
+     * Anything below table->len is a single lookup. Past that, this jumps k steps at a time until it gets there.
+     * Returns 0 if n is 0, or if the chain can't be followed without 128-bit integers
+     *
+     * See collatz_table, collatz_descend
+     */
+    uint32_t ret = 0;
+    uint64_t mask = ((uint64_t) 1 << table->jump_bits) - 1;
+    while (n >= table->len) {
+        if (n >= table->jump_limit) {
+            if (!(n = collatz_descend(table, n, &ret)))  {
+                return 0;
+            }
+            continue;
+        }
+        uint64_t jump = table->jumps[n & mask];
+        n = (n >> table->jump_bits) * (jump >> 34) + ((jump >> 5) & 0x1FFFFFFF);
+        ret += table->jump_bits + (jump & 0x1F);
+    }
+    return ret + table->lengths[n];
+}
+
+#if HAS_X64_SIMD
+__attribute__((target("avx2")))
+void collatz_jump_avx2(const collatz_table *table, uint64_t *starts, uint32_t *lengths)    {
+    // runs the jump loop of collatz_length() on 4 lanes at once, until every lane is below len, or one of them hits
+    // jump_limit. Lanes that are done stop moving, and starts and lengths are left wherever each lane got to
+    // AVX2 has no 64-bit multiply, but 3^c < 2^32, so a * 3^c is built from two 32 x 32 -> 64 bit multiplies
+    const __m256i len = _mm256_set1_epi64x((long long) table->len - 1);
+    const __m256i limit = _mm256_set1_epi64x((long long) table->jump_limit - 1);
+    const __m256i mask = _mm256_set1_epi64x(((long long) 1 << table->jump_bits) - 1);
+    const __m256i odd = _mm256_set1_epi64x(0x1F), offset = _mm256_set1_epi64x(0x1FFFFFFF);
+    const __m256i bits = _mm256_set1_epi64x(table->jump_bits);
+    const __m128i shift = _mm_cvtsi32_si128(table->jump_bits);
+    __m256i x = _mm256_loadu_si256((const __m256i *) starts), steps = _mm256_setzero_si256();
+    // jump_limit is below 2^63, so a signed compare works for anything that passes the sign check
+    __m256i active = _mm256_cmpgt_epi64(x, len);
+    while (!_mm256_testz_si256(active, active)) {
+        if (_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_or_si256(x, _mm256_cmpgt_epi64(x, limit)))))   {
+            break;
+        }
+        __m256i a = _mm256_srl_epi64(x, shift);
+        __m256i jump = _mm256_mask_i64gather_epi64(
+            _mm256_setzero_si256(), (const long long *) table->jumps, _mm256_and_si256(x, mask), active, 8
+        );
+        __m256i power = _mm256_srli_epi64(jump, 34);
+        __m256i product = _mm256_add_epi64(
+            _mm256_mul_epu32(a, power), _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), power), 32)
+        );
+        __m256i next = _mm256_add_epi64(product, _mm256_and_si256(_mm256_srli_epi64(jump, 5), offset));
+        x = _mm256_blendv_epi8(x, next, active);
+        steps = _mm256_add_epi64(steps, _mm256_and_si256(_mm256_add_epi64(bits, _mm256_and_si256(jump, odd)), active));
+        active = _mm256_cmpgt_epi64(x, len);
+    }
+    _mm256_storeu_si256((__m256i *) starts, x);
+    uint64_t taken[4];
+    _mm256_storeu_si256((__m256i *) taken, steps);
+    for (unsigned char i = 0; i < 4; i++)   {
+        lengths[i] = (uint32_t) taken[i];
+    }
+}
+
+bool collatz_has_avx2(void) {
+    // checks the CPU once, then remembers the answer
+    static signed char cached = -1;
+    if (cached < 0) {
+        cached = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return cached;
+}
+#endif
+
+void collatz_length_x4(const collatz_table *table, const uint64_t *starts, uint32_t *lengths)   {
+    /**
+     * Finds the lengths of the chains starting at 4 values at once
+     * @table: The tables to look things up in
+     * @starts: The 4 starting values
+     * @lengths: Where to store the 4 lengths, each as collatz_length() would give it
+     *
+     * On x86_64 CPUs with AVX2, the jumps run in vector lanes, with gathers for the table lookups. Whatever the lanes
+     * leave unfinished, including any lane that strays past jump_limit, is handed to collatz_length(). Lanes that
+     * finish early sit idle until the slowest one is done, so this only beats 4 calls to collatz_length() where
+     * gathers are cheap, which is why range searches leave it behind COLLATZ_SEARCH_LANES
+     *
+     * See collatz_length
+     */
+    uint64_t x[4] = {starts[0], starts[1], starts[2], starts[3]};
+    uint32_t taken[4] = {0, 0, 0, 0};
+#if HAS_X64_SIMD
+    if (collatz_has_avx2()) {
+        collatz_jump_avx2(table, x, taken);
+    }
+#endif
+    for (unsigned char i = 0; i < 4; i++)   {
+        uint32_t rest = collatz_length(table, x[i]);
+        lengths[i] = rest ? taken[i] + rest : 0;
+    }
+}
+
+typedef struct collatz_record collatz_record;
+struct collatz_record   {
+    /**
+     * The result of a range search
+     * @start: The starting value with the longest chain, or 0 if the range was empty
+     * @length: The length of that chain
+     */
+    uint64_t start;
+    uint32_t length;
+};
+
+typedef struct collatz_search collatz_search;
+struct collatz_search   {
+    /**
+     * The state shared between the workers of a range search
+     * @table: The tables every worker looks things up in
+     * @lo: The first starting value in the range
+     * @hi: The (exclusive) upper bound of the range
+     * @units: The number of units in the range, each COLLATZ_UNIT starting values long
+     * @next_unit: The next unit that no worker has claimed
+     * @records: The best record each worker has found
+     * @lock: The mutex protecting next_unit
+     */
+    const collatz_table *table;
+    uint64_t lo;
+    uint64_t hi;
+    size_t units;
+    size_t next_unit;
+    collatz_record *records;
+#if HAS_PTHREADS
+    pthread_mutex_t lock;
+#endif
+};
+
+typedef struct collatz_search_worker collatz_search_worker;
+struct collatz_search_worker    {
+    /**
+     * The per-thread state of a range search worker
+     * @search: The state shared with the other workers
+     * @idx: The index of this worker, which picks its entry in search->records
+     * @thread: The thread running this worker
+     */
+    collatz_search *search;
+    size_t idx;
+#if HAS_PTHREADS
+    pthread_t thread;
+#endif
+};
+
+void *collatz_search_worker_loop(void *arg)   {
+    /**
+     * The worker loop for collatz_longest(), which claims units in any order, and keeps the best record it sees
+     * @arg: The collatz_search_worker for this thread
+     */
+    collatz_search_worker *worker = (collatz_search_worker *) arg;
+    collatz_search *search = worker->search;
+    collatz_record *best = search->records + worker->idx;
+#if COLLATZ_SEARCH_LANES
+    uint32_t lengths[4];
+#endif
+    while (true)    {
+        parallel_sieve_lock(search);
+        size_t unit = search->next_unit++;
+        parallel_sieve_unlock(search);
+        if (unit >= search->units)  {
+            break;
+        }
+        uint64_t n = search->lo + unit * COLLATZ_UNIT, high = min(n + COLLATZ_UNIT, search->hi);
+        // units go in order within a worker, so strict compares keep the smallest start on ties
+#if COLLATZ_SEARCH_LANES
+        for (; n + 4 <= high; n += 4)   {
+            uint64_t starts[4] = {n, n + 1, n + 2, n + 3};
+            collatz_length_x4(search->table, starts, lengths);
+            for (unsigned char i = 0; i < 4; i++)   {
+                if (lengths[i] > best->length)  {
+                    best->start = starts[i];
+                    best->length = lengths[i];
+                }
+            }
+        }
+#endif
+        for (; n < high; n++)   {
+            uint32_t length = collatz_length(search->table, n);
+            if (length > best->length)  {
+                best->start = n;
+                best->length = length;
+            }
+        }
+    }
+    return NULL;
+}
+
+collatz_record collatz_longest(const collatz_table *table, uint64_t lo, uint64_t hi, unsigned threads)   {
+    /**
+     * Finds the starting value in [lo, hi) with the longest chain, using a pool of worker threads
+     * @table: The tables to look things up in
+     * @lo: The (inclusive) lower bound of the range
+     * @hi: The (exclusive) upper bound of the range
+     * @threads: The number of worker threads, or 0 to use parallel_sieve_threads()
+     *
+     * Ties go to the smallest starting value, so the answer doesn't depend on the number of threads. Any n with 2n
+     * still in range can't win, since 2n's chain is one term longer, so only the top half of the range gets searched.
+     * Anything below table->len is a lookup, so the table should cover as much of that as memory allows. Without
+     * pthreads this runs everything on the calling thread
+     *
+     * See collatz_table, collatz_length_x4
+     */
+    collatz_search search;
+    collatz_record ret = {0, 0};
+    search.table = table;
+    search.lo = hi ? max(max(lo, 1), (hi - 1) / 2 + 1) : 1;
+    search.hi = hi;
+    search.units = (hi > search.lo) ? (hi - search.lo - 1) / COLLATZ_UNIT + 1 : 0;
+    search.next_unit = 0;
+#if HAS_PTHREADS
+    if (!threads)   {
+        threads = parallel_sieve_threads();
+    }
+    threads = (unsigned) min(threads, max(search.units, 1));
+#else
+    threads = 1;
+#endif
+    search.records = (collatz_record *) calloc(threads, sizeof(collatz_record));
+#if HAS_PTHREADS
+    pthread_mutex_init(&search.lock, NULL);
+    collatz_search_worker *workers = (collatz_search_worker *) malloc(threads * sizeof(collatz_search_worker));
+    for (unsigned i = 0; i < threads; i++)  {
+        workers[i].search = &search;
+        workers[i].idx = i;
+        pthread_create(&workers[i].thread, NULL, &collatz_search_worker_loop, &workers[i]);
+    }
+    for (unsigned i = 0; i < threads; i++)  {
+        pthread_join(workers[i].thread, NULL);
+    }
+    free(workers);
+    pthread_mutex_destroy(&search.lock);
+#else
+    collatz_search_worker worker = {&search, 0};
+    collatz_search_worker_loop(&worker);
+#endif
+    for (unsigned i = 0; i < threads; i++)  {
+        collatz_record r = search.records[i];
+        if (r.length > ret.length || (r.length == ret.length && r.length && r.start < ret.start))  {
+            ret = r;
+        }
+    }
+    free(search.records);
+    return ret;
+}
+
+#endif
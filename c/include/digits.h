@@ -3,49 +3,295 @@
 
 #include "macros.h"
 #include "iterator.h"
+#include "math.h"
 
-#if !PCC_COMPILER
-    #include <stdlib.h>
-    #include <math.h>
-#else
-    #include "math.h"
-#endif
+#include <stddef.h>
+
+#define MAX_DIGITS_64 20
+    /**
+     * The number of decimal digits in the largest uint64_t, which is how much room a digit_counter needs
+     */
+
+// the ASCII digits of 00 thru 99, so that two digits can be split off with a single division by 100
+static const char digit_pairs[201] =
+    "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+    "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+static const uintmax_t digit_factorials[10] = {1, 1, 2, 6, 24, 120, 720, 5040, 40320, 362880};
 
 typedef struct digit_counter digit_counter;
 struct digit_counter    {
+    /**
+     * The iterator that yields the decimal digits of a number, without allocating anything
+     * @iterator_function: The function to advance the iterator and return the next element
+     * @exhausted: An indicator that tells you if the iterator is exhausted
+     * @started: An indicator that tells you if the interator has moved at all
+     * @phase: An indicator that flips every time the iterator moves
+     * @digits: The digits of the number, least significant first
+     * @len: The number of entries in digits, which is at least 1
+     * @idx: The index of the next entry of digits to yield
+     * @reverse: If set, yield the least significant digit first instead of the most
+     *
+     * See IteratorHead
+     */
     IteratorHead(unsigned char, digit_counter);
-    unsigned char *digits;
-    size_t idx;
+    unsigned char digits[MAX_DIGITS_64];
+    unsigned char len;
+    unsigned char idx;
+    bool reverse;
 };
 
-unsigned char advance_digit_counter(digit_counter *dc)  {
+unsigned char advance_digit_counter(digit_counter *dc);
+inline unsigned char advance_digit_counter(digit_counter *dc)  {
+    /**
+     * The function to advance a digit_counter, which walks idx up from the least significant digit if reverse is
+     * set, or down from the most significant one otherwise
+     * @dc: The counter you want to advance
+     *
+     * Returns the next digit
+     */
     IterationHead(dc);
-    unsigned char ret = dc->digits[dc->idx--];
-    dc->exhausted = (dc->idx == -1);
+    if (dc->reverse)    {
+        unsigned char ret = dc->digits[dc->idx++];
+        dc->exhausted = (dc->idx == dc->len);
+        return ret;
+    }
+    unsigned char ret = dc->digits[dc->idx];
+    dc->exhausted = !(dc->idx--);
     return ret;
 }
 
-digit_counter digits(uintmax_t n)  {
+unsigned char fill_digits(unsigned char *digits, uint64_t n)  {
+    /**
+     * Writes the decimal digits of n into digits, least significant first, two at a time
+     * @digits: Where to store the digits, which needs room for MAX_DIGITS_64 entries
+     * @n: The number to split up
+     *
+     * Returns the number of digits written, which is 1 if n is 0
+     */
+    unsigned char len = 0;
+    for (; n >= 100; n /= 100, len += 2)    {
+        unsigned int pair = (n % 100) * 2;
+        digits[len] = digit_pairs[pair + 1] - '0';
+        digits[len + 1] = digit_pairs[pair] - '0';
+    }
+    if (n >= 10)    {
+        digits[len++] = digit_pairs[n * 2 + 1] - '0';
+        digits[len++] = digit_pairs[n * 2] - '0';
+    } else  {
+        digits[len++] = n;
+    }
+    return len;
+}
+
+digit_counter digits2(uintmax_t n, bool reverse);
+inline digit_counter digits2(uintmax_t n, bool reverse)   {
+    /**
+     * The base constructor for the digit_counter iterator
+     * @n: The number whose digits you want. 0 yields a single 0
+     * @reverse: If set, yield the least significant digit first instead of the most
+     *
+     * See digit_counter
+     */
     digit_counter ret;
     IteratorInitHead(ret, advance_digit_counter);
-#if !PCC_COMPILER
-    size_t digit_len = ceil(log10(n + 1));
-#else
-    size_t digit_len = imprecise_log10(n + 1);
-#endif
-    ret.digits = (unsigned char *) malloc(digit_len * sizeof(unsigned char));
-    for (size_t i = 0; i < digit_len; i++)    {
-        ret.digits[i] = n % 10;
-        n /= 10;
+    ret.len = fill_digits(ret.digits, n);
+    ret.reverse = reverse;
+    ret.idx = reverse ? 0 : ret.len - 1;
+    return ret;
+}
+
+digit_counter digits(uintmax_t n);
+inline digit_counter digits(uintmax_t n)  {
+    /**
+     * The simpler constructor for the digit_counter iterator, which yields the most significant digit first
+     * @n: The number whose digits you want. 0 yields a single 0
+     *
+     * See digit_counter
+     */
+    return digits2(n, false);
+}
+
+void free_digit_counter(digit_counter dc);
+inline void free_digit_counter(digit_counter dc)   {
+    // digit_counter no longer owns any memory, so this does nothing, but it's kept for symmetry with other iterators
+}
+
+uintmax_t digit_sum(uintmax_t n);
+inline uintmax_t digit_sum(uintmax_t n)  {
+    /**
+     * Sums the decimal digits of n, splitting off two at a time
+     * @n: The number whose digits you want to sum
+     */
+    uintmax_t ret = 0;
+    for (; n; n /= 100) {
+        unsigned int pair = (n % 100) * 2;
+        ret += (digit_pairs[pair] - '0') + (digit_pairs[pair + 1] - '0');
     }
-    ret.idx = digit_len - 1;
     return ret;
 }
 
-void free_digit_counter(digit_counter dc)   {
-    if (dc.digits != NULL)  {
-        free(dc.digits);
+uintmax_t digit_factorial_sum(uintmax_t n);
+inline uintmax_t digit_factorial_sum(uintmax_t n)    {
+    /**
+     * Sums the factorials of the decimal digits of n, splitting off two at a time
+     * @n: The number whose digits you want to use. 0 counts as the single digit 0, so gives 1
+     */
+    uintmax_t ret = 0;
+    if (!n) {
+        return 1;
+    }
+    for (; n >= 10; n /= 100)   {
+        unsigned int pair = n % 100;
+        ret += digit_factorials[pair / 10] + digit_factorials[pair % 10];
+    }
+    return n ? ret + digit_factorials[n] : ret;
+}
+
+bool is_palindrome(uintmax_t n, unsigned int base)  {
+    /**
+     * Checks if n reads the same in both directions when written in the given base
+     * @n: The number to check
+     * @base: The base to write n in, which must be at least 2
+     *
+     * Only the bottom half of n gets reversed, and it stops once that half catches up with what remains, so this
+     * never overflows. Multiples of base can never be palindromes, since they would need a leading zero. Bases 2 and
+     * 10 get their own loops, so that they can skip the general division
+     */
+    if (n && !(n % base))  {
+        return false;
+    }
+    uintmax_t rev = 0;
+    if (base == 2)  {
+        for (; n > rev; n >>= 1)   {
+            rev = (rev << 1) | (n & 1);
+        }
+        return n == rev || n == (rev >> 1);
+    }
+    if (base == 10) {
+        for (; n > rev; n /= 10)    {
+            rev = rev * 10 + n % 10;
+        }
+        return n == rev || n == rev / 10;
+    }
+    for (; n > rev; n /= base)  {
+        rev = rev * base + n % base;
+    }
+    return n == rev || n == rev / base;
+}
+
+typedef struct digit_odometer digit_odometer;
+struct digit_odometer   {
+    /**
+     * The iterator that yields consecutive numbers while keeping their decimal digits, and some sums over them, up to
+     * date. Going from n to n + 1 only touches the trailing 9s and the digit above them, so each step takes amortized
+     * O(1) time instead of a division per digit
+     * @iterator_function: The function to advance the iterator and return the next element
+     * @exhausted: An indicator that tells you if the iterator is exhausted
+     * @started: An indicator that tells you if the interator has moved at all
+     * @phase: An indicator that flips every time the iterator moves
+     * @digits: The digits of value, least significant first
+     * @len: The number of entries in digits, which is at least 1
+     * @value: The number most recently yielded
+     * @stop: The point where the odometer is exhausted
+     * @digit_sum: The sum of the digits of value
+     * @table: A caller supplied table of f(0) thru f(9), or NULL
+     * @table_sum: The sum of f(d) over the digits d of value, if table is set
+     *
+     * See IteratorHead
+     */
+    IteratorHead(uintmax_t, digit_odometer);
+    unsigned char digits[MAX_DIGITS_64];
+    unsigned char len;
+    uintmax_t value;
+    uintmax_t stop;
+    uintmax_t digit_sum;
+    const uintmax_t *table;
+    uintmax_t table_sum;
+};
+
+void step_digit_odometer(digit_odometer *od);
+inline void step_digit_odometer(digit_odometer *od) {
+    /**
+     * Moves the odometer from value to value + 1, without checking stop
+     * @od: The odometer to move
+     *
+     * Each trailing 9 rolls over to 0, then the digit above them goes up by one, growing the number if needed
+     */
+    unsigned char i = 0;
+    for (; i < od->len && od->digits[i] == 9; i++)  {
+        od->digits[i] = 0;
+    }
+    bool grew = (i == od->len);
+    if (grew)   {
+        od->digits[od->len++] = 0;
+    }
+    od->digit_sum = od->digit_sum + 1 - 9 * i;
+    if (od->table)  {
+        od->table_sum += i * (od->table[0] - od->table[9]);
+        if (grew)   {  // a brand new leading digit, which was never counted as a 0
+            od->table_sum += od->table[1];
+        } else  {
+            od->table_sum += od->table[od->digits[i] + 1] - od->table[od->digits[i]];
+        }
+    }
+    od->digits[i]++;
+    od->value++;
+}
+
+uintmax_t advance_digit_odometer(digit_odometer *od);
+inline uintmax_t advance_digit_odometer(digit_odometer *od)    {
+    /**
+     * The function to advance a digit_odometer, which yields start on its first call and steps up by one after that
+     * @od: The odometer you want to advance
+     *
+     * Returns the next number, whose digits and sums are left in od
+     */
+    if (od->started)    {
+        step_digit_odometer(od);
+    }
+    IterationHead(od);
+    od->exhausted = (od->value + 1 >= od->stop);
+    return od->value;
+}
+
+digit_odometer digit_odometer3(uintmax_t start, uintmax_t stop, const uintmax_t *table);
+inline digit_odometer digit_odometer3(uintmax_t start, uintmax_t stop, const uintmax_t *table)  {
+    /**
+     * The base constructor for the digit_odometer iterator
+     * @start: The first number to yield
+     * @stop: The point where the odometer is exhausted
+     * @table: A table of f(0) thru f(9) to keep table_sum for, like digit_factorials, or NULL to skip it
+     *
+     * See digit_odometer
+     */
+    digit_odometer ret;
+    IteratorInitHead(ret, advance_digit_odometer);
+    ret.exhausted = (start >= stop);
+    ret.len = fill_digits(ret.digits, start);
+    ret.value = start;
+    ret.stop = stop;
+    ret.table = table;
+    ret.digit_sum = ret.table_sum = 0;
+    for (unsigned char i = 0; i < ret.len; i++) {
+        ret.digit_sum += ret.digits[i];
+        if (table)  {
+            ret.table_sum += table[ret.digits[i]];
+        }
     }
+    return ret;
+}
+
+digit_odometer digit_odometer2(uintmax_t start, uintmax_t stop);
+inline digit_odometer digit_odometer2(uintmax_t start, uintmax_t stop)  {
+    /**
+     * The simpler constructor for the digit_odometer iterator, which only keeps digit_sum
+     * @start: The first number to yield
+     * @stop: The point where the odometer is exhausted
+     *
+     * See digit_odometer
+     */
+    return digit_odometer3(start, stop, NULL);
 }
 
 #endif
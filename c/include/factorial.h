@@ -0,0 +1,141 @@
+#ifndef FACTORIAL_H
+#define FACTORIAL_H
+
+#include "macros.h"
+#include "math.h"
+#include "primes.h"
+#include "bigint.h"
+
+#if !PCC_COMPILER
+    #include <stdlib.h>
+#endif
+
+// big factorials use Luschny's prime swing: n! = ((n / 2)!)^2 * swing(n), where swing(n) = n! / ((n / 2)!)^2 is the
+// product of p^e over the primes up to n, with e the number of odd terms in n / p, n / p^2, ... Each level of the
+// recursion is a squaring and one product of small prime powers, so the work is dominated by a few balanced
+// multiplications instead of n small ones
+
+uint64_t *factorial_primes(uintmax_t n, size_t *len)    {
+    /**
+     * Lists the primes up to n, for factorial_bigint() to share between its levels
+     * @n: The largest number that might be listed
+     * @len: Where to store the length of the list
+     *
+     * The caller is responsible for freeing the list
+     */
+    size_t size = 64;
+    uint64_t *ret = (uint64_t *) malloc(sizeof(uint64_t) * size);
+    prime_sieve ps = prime_sieve0();
+    *len = 0;
+    for (uintmax_t p = next(ps); p <= n; p = next(ps))  {
+        if (*len == size)   {
+            size *= 2;
+            ret = (uint64_t *) realloc(ret, sizeof(uint64_t) * size);
+        }
+        ret[(*len)++] = p;
+    }
+    free_prime_sieve(ps);
+    return ret;
+}
+
+bigint prime_swing(uintmax_t n, const uint64_t *primes, size_t len)   {
+    /**
+     * Computes swing(n) = n! / ((n / 2)!)^2
+     * @n: The number to swing
+     * @primes: The primes up to at least n, in order
+     * @len: The number of entries in primes
+     *
+     * Each prime's exponent is the number of odd values among n / p, n / p^2, ..., which is at most log_p(n), so the
+     * prime powers get packed into machine words, then multiplied out by product_bigint_words()
+     *
+     * See product_bigint_words
+     */
+    size_t count = 0, size = 64;
+    uint64_t *words = (uint64_t *) malloc(sizeof(uint64_t) * size), word = 1;
+    for (size_t i = 0; i < len && primes[i] <= n; i++)  {
+        uint64_t p = primes[i];
+        unsigned char e = 0;
+        for (uintmax_t q = n / p; q; q /= p)    {
+            e += q & 1;
+        }
+        for (; e; e--)  {
+            if (word > UINT64_MAX / p)  {
+                if (count == size)  {
+                    size *= 2;
+                    words = (uint64_t *) realloc(words, sizeof(uint64_t) * size);
+                }
+                words[count++] = word;
+                word = 1;
+            }
+            word *= p;
+        }
+    }
+    if (count == size)  {
+        words = (uint64_t *) realloc(words, sizeof(uint64_t) * (size + 1));
+    }
+    words[count++] = word;
+    bigint ret = product_bigint_words(words, count);
+    free(words);
+    return ret;
+}
+
+bigint factorial_swing_recursive(uintmax_t n, const uint64_t *primes, size_t len)  {
+    if (n <= MAX_FACTORIAL_64)  {
+        return new_bigint(factorial(n), false);
+    }
+    bigint half = factorial_swing_recursive(n / 2, primes, len), swing = prime_swing(n, primes, len);
+    bigint square = mul_bigint(half, half), ret = mul_bigint(square, swing);
+    free_bigint(half);
+    free_bigint(swing);
+    free_bigint(square);
+    return ret;
+}
+
+bigint factorial_bigint(uintmax_t n)    {
+    /**
+     * Computes n! exactly
+     * @n: The number whose factorial you want
+     *
+     * Anything up to MAX_FACTORIAL_64 comes straight from factorial()'s table. Past that, this sieves the primes up
+     * to n once, then recurses on the prime swing. The caller is responsible for freeing the result
+     *
+     * See prime_swing, bcd_from_bigint
+     */
+    if (n <= MAX_FACTORIAL_64)  {
+        return new_bigint(factorial(n), false);
+    }
+    size_t len;
+    uint64_t *primes = factorial_primes(n, &len);
+    bigint ret = factorial_swing_recursive(n, primes, len);
+    free(primes);
+    return ret;
+}
+
+uint64_t factorial_mod(uintmax_t n, uint64_t m)   {
+    /**
+     * Computes n! mod m
+     * @n: The number whose factorial you want
+     * @m: The non-zero modulus
+     *
+     * If n >= m, then m is one of the factors, so the answer is 0. If m is prime and n is past m / 2, Wilson's
+     * theorem says (m - 1)! = -1, so n! = -1 / ((n + 1) * ... * (m - 1)), which is the shorter product. Otherwise this
+     * multiplies it out directly, so it takes O(min(n, m - n)) steps
+     */
+    if (n >= m) {
+        return 0;
+    }
+    uint64_t ret = 1 % m;
+    if (n > m / 2 && is_prime(m))   {
+        for (uint64_t i = n + 1; i < m; i++)    {
+            ret = mul_mod(ret, i, m);
+        }
+        // m - 1 is -1, and the inverse by Fermat's little theorem
+        return m - pow_mod(ret, m - 2, m);
+    }
+    for (uint64_t i = 2; i <= n; i++)   {
+        ret = mul_mod(ret, i, m);
+    }
+    return ret;
+}
+
+#endif
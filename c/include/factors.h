@@ -2,44 +2,185 @@
 #define DIVISORS_H
 
 #include "iterator.h"
+#include "primes.h"
+
+uintmax_t divisor_sigma(uintmax_t n, unsigned char k)   {
+    /**
+     * Computes sigma_k(n), the sum of the kth powers of the divisors of n, from its prime factorization
+     * @n: The non-zero number whose divisors you want to sum
+     * @k: The power to raise each divisor to. 0 counts the divisors, and 1 sums them
+     *
+     * sigma_k is multiplicative, and sigma_k(p^e) = 1 + p^k + p^2k + ... + p^ek, so this never looks at the
+     * divisors themselves. Note that the result wraps around if it does not fit in a uintmax_t
+     *
+     * See prime_factor_counter
+     */
+    uintmax_t ret = 1, term = 1, p_k = 1, p, last = 0;
+    prime_factor_counter pfc = prime_factors(n);
+    while (!pfc.exhausted && (p = next(pfc)) != (uintmax_t) -1)   {
+        if (p != last)  {
+            ret *= term;
+            p_k = 1;
+            for (unsigned char i = 0; i < k; i++)   {
+                p_k *= p;
+            }
+            term = 1;
+            last = p;
+        }
+        term = term * p_k + 1;
+    }
+    free_prime_factor_counter(pfc);
+    return ret * term;
+}
+
+uintmax_t divisor_count(uintmax_t n);
+inline uintmax_t divisor_count(uintmax_t n)  {
+    /**
+     * Counts the divisors of n, including 1 and n itself
+     * @n: The non-zero number whose divisors you want to count
+     *
+     * See divisor_sigma
+     */
+    return divisor_sigma(n, 0);
+}
+
+int cmp_uintmax(const void *a, const void *b)   {
+    uintmax_t x = *(const uintmax_t *) a, y = *(const uintmax_t *) b;
+    return (x > y) - (x < y);
+}
+
+uintmax_t *divisor_list(uintmax_t n, size_t *len)   {
+    /**
+     * Builds the sorted list of divisors of n, including 1 and n itself, from its prime factorization
+     * @n: The non-zero number whose divisors you want
+     * @len: Where to store the length of the list
+     *
+     * Each prime power p^e multiplies the list so far by p, p^2, ..., p^e, so every divisor is generated exactly
+     * once. The caller is responsible for freeing the list
+     *
+     * See prime_factor_counter
+     */
+    uintmax_t *ret = (uintmax_t *) malloc(divisor_count(n) * sizeof(uintmax_t));
+    uintmax_t p, last = 0;
+    size_t base_len = 1;
+    prime_factor_counter pfc = prime_factors(n);
+    ret[0] = 1;
+    *len = 1;
+    while (!pfc.exhausted && (p = next(pfc)) != (uintmax_t) -1)   {
+        if (p != last)  {  // a new prime multiplies everything found so far
+            base_len = *len;
+            last = p;
+        }
+        // a repeated prime only needs to extend the divisors produced by the previous power
+        size_t start = *len - base_len;
+        for (size_t i = 0; i < base_len; i++)   {
+            ret[(*len)++] = ret[start + i] * p;
+        }
+    }
+    free_prime_factor_counter(pfc);
+    qsort(ret, *len, sizeof(uintmax_t), cmp_uintmax);
+    return ret;
+}
 
 typedef struct factor_counter factor_counter;
 struct factor_counter   {
+    /**
+     * The iterator that yields the divisors of a number in ascending order
+     * @iterator_function: The function to advance the iterator and return the next element
+     * @exhausted: An indicator that tells you if the iterator is exhausted
+     * @started: An indicator that tells you if the interator has moved at all
+     * @phase: An indicator that flips every time the iterator moves
+     * @target: The number whose divisors are being yielded
+     * @current: The divisor most recently yielded
+     * @divisors: The sorted divisors of target, as built by divisor_list()
+     * @len: The number of entries in divisors
+     * @idx: The index of the next entry of divisors to yield
+     *
+     * See IteratorHead
+     */
     IteratorHead(uintmax_t, factor_counter);
     uintmax_t target;
     uintmax_t current;
+    uintmax_t *divisors;
+    size_t len;
+    size_t idx;
 };
 
 uintmax_t advance_factor_counter(factor_counter *fc);
 inline uintmax_t advance_factor_counter(factor_counter *fc) {
     IterationHead(fc);
-    while (fc->target > fc->current)   {
-        fc->current++;
-        if (fc->target % fc->current == 0)  {
-            fc->exhausted = (fc->target == fc->current);
-            return fc->current;
-        }
+    if (fc->idx >= fc->len) {
+        fc->exhausted = true;
+        return 0;
     }
-    return 0;
+    fc->current = fc->divisors[fc->idx++];
+    fc->exhausted = (fc->idx == fc->len);
+    return fc->current;
 }
 
 factor_counter proper_divisors(uintmax_t target);
 inline factor_counter proper_divisors(uintmax_t target) {
+    /**
+     * The constructor for the factor_counter iterator, which yields every divisor of target in ascending order,
+     * including target itself
+     * @target: The non-zero number whose divisors you want
+     *
+     * The whole list is built up front by divisor_list(), so the caller owns it, and must call free_factor_counter()
+     * when done, whether or not the iterator was run to the end
+     *
+     * See factor_counter, divisor_list
+     */
     factor_counter ret;
     IteratorInitHead(ret, advance_factor_counter);
     ret.target = target;
     ret.current = 0;
+    ret.divisors = divisor_list(target, &ret.len);
+    ret.idx = 0;
     return ret;
 }
 
+void free_factor_counter(factor_counter fc);
+inline void free_factor_counter(factor_counter fc)  {
+    free(fc.divisors);
+}
+
 uintmax_t proper_divisor_count(uintmax_t target);
 inline uintmax_t proper_divisor_count(uintmax_t target) {
-    uintmax_t ret = 0;
-    factor_counter fc = proper_divisors(target);
-    while (!fc.exhausted)   {
-        next(fc);
-        ret++;
+    // note that, like proper_divisors, this counts target itself
+    return divisor_count(target);
+}
+
+uintmax_t *divisor_sigma_table(const spf_table *table, unsigned char k)  {
+    /**
+     * Fills in sigma_k(n) for every n below table->len
+     * @table: A smallest prime factor table, as built by spf_table3()
+     * @k: The power to raise each divisor to. 0 counts the divisors, and 1 sums them
+     *
+     * Each n is split into the power of its smallest prime, p^e, and the rest, which are both smaller and so
+     * already filled in. Prime powers extend the previous one with sigma_k(p^e) = p^k * sigma_k(p^(e-1)) + 1, so
+     * the whole table takes O(N) time on top of building spf_table. Entry 0 is left as 0, and the caller is
+     * responsible for freeing the table
+     *
+     * See divisor_sigma, spf_table3
+     */
+    uint32_t len = table->len;
+    uintmax_t *ret = (uintmax_t *) calloc(max(len, 2), sizeof(uintmax_t));
+    uint32_t *powers = (uint32_t *) malloc(max(len, 2) * sizeof(uint32_t));  // the largest power of spf[n] dividing n
+    ret[1] = 1;
+    for (uint32_t n = 2; n < len; n++)  {
+        uint32_t p = table->spf[n], rest = n / p;
+        powers[n] = (table->spf[rest] == p) ? powers[rest] * p : p;
+        if (powers[n] == n) {
+            uintmax_t p_k = 1;
+            for (unsigned char i = 0; i < k; i++)   {
+                p_k *= p;
+            }
+            ret[n] = ret[rest] * p_k + 1;
+        } else  {
+            ret[n] = ret[powers[n]] * ret[n / powers[n]];
+        }
     }
+    free(powers);
     return ret;
 }
 
@@ -2,6 +2,9 @@
 #define FIBONACCI_H
 
 #include "iterator.h"
+#include "math.h"
+#include "primes.h"
+#include "bigint.h"
 
 typedef struct fibonacci fibonacci;
 struct fibonacci    {
@@ -37,4 +40,225 @@ inline fibonacci fibonacci0()   {
     return fibonacci1(-1);
 }
 
+// the functions below use fast doubling, which walks the bits of n from the top down, keeping F(k) and F(k + 1):
+// F(2k) = F(k) * (2F(k + 1) - F(k))
+// F(2k + 1) = F(k)^2 + F(k + 1)^2
+// so F(n) takes O(log(n)) steps instead of n additions
+
+uint64_t fibonacci_mod_pair(uintmax_t n, uint64_t m, uint64_t *next_term)  {
+    /**
+     * Computes F(n) and F(n + 1) modulo m by fast doubling
+     * @n: The index of the term you want, with F(0) = 0 and F(1) = 1
+     * @m: The non-zero modulus
+     * @next_term: Where to store F(n + 1) mod m
+     *
+     * Every intermediate is kept below m, and products go through mul_mod(), so any 64-bit m works
+     */
+    uint64_t a = 0, b = 1 % m, c, d, twice_b;
+    uintmax_t mask = ~(UINTMAX_MAX >> 1);
+    for (; mask && !(n & mask); mask >>= 1);
+    for (; mask; mask >>= 1)    {
+        twice_b = (b >= m - b) ? b - (m - b) : b + b;
+        c = mul_mod(a, (twice_b >= a) ? twice_b - a : twice_b + (m - a), m);
+        d = mul_mod(a, a, m);
+        twice_b = mul_mod(b, b, m);  // reused to hold F(k + 1)^2
+        d = (d >= m - twice_b) ? d - (m - twice_b) : d + twice_b;
+        if (n & mask)   {
+            a = d;
+            b = (c >= m - d) ? c - (m - d) : c + d;
+        }
+        else    {
+            a = c;
+            b = d;
+        }
+    }
+    *next_term = b;
+    return a;
+}
+
+uint64_t fibonacci_mod(uintmax_t n, uint64_t m);
+inline uint64_t fibonacci_mod(uintmax_t n, uint64_t m)  {
+    /**
+     * Computes F(n) modulo m in O(log(n)) multiplications
+     * @n: The index of the term you want, with F(0) = 0 and F(1) = 1
+     * @m: The non-zero modulus
+     *
+     * See fibonacci_mod_pair
+     */
+    uint64_t next_term;
+    return fibonacci_mod_pair(n, m, &next_term);
+}
+
+bool is_pisano_multiple(uintmax_t k, uint64_t m);
+inline bool is_pisano_multiple(uintmax_t k, uint64_t m)    {
+    // the sequence mod m repeats every k terms exactly when F(k) = 0 and F(k + 1) = 1
+    uint64_t next_term, term = fibonacci_mod_pair(k, m, &next_term);
+    return !term && next_term == 1 % m;
+}
+
+uintmax_t pisano_reduce(uintmax_t k, uintmax_t q, uint64_t m)    {
+    /**
+     * Strips as many factors of q from the period multiple k as it can, while keeping it a period mod m
+     * @k: A multiple of the Pisano period of m
+     * @q: A prime factor of k
+     * @m: The modulus
+     */
+    while (k % q == 0 && is_pisano_multiple(k / q, m))  {
+        k /= q;
+    }
+    return k;
+}
+
+uintmax_t pisano_prime_power_period(uintmax_t p, uintmax_t prime_power)   {
+    /**
+     * Computes the Pisano period of a prime power
+     * @p: The prime
+     * @prime_power: The power of p to use
+     *
+     * For p = 2 and p = 5 the period of p is 3 and 20. Otherwise it divides p - 1 when p = +-1 mod 5, and 2(p + 1)
+     * when p = +-2 mod 5, so it's found by stripping prime factors from those while they still give a period. Going
+     * up to p^e multiplies that by at most p^(e - 1), and stripping factors of p settles exactly how much
+     */
+    uintmax_t k = (p == 2) ? 3 : (p == 5) ? 20 : (p % 5 == 1 || p % 5 == 4) ? p - 1 : 2 * (p + 1);
+    if (p != 2 && p != 5)   {
+        uintmax_t q, last = 0;
+        prime_factor_counter pfc = prime_factors(k);
+        while (!pfc.exhausted && (q = next(pfc)) != (uintmax_t) -1)   {
+            if (q != last)  {
+                k = pisano_reduce(k, q, p);
+                last = q;
+            }
+        }
+        free_prime_factor_counter(pfc);
+    }
+    return pisano_reduce(k * (prime_power / p), p, prime_power);
+}
+
+uintmax_t pisano_period(uint64_t m)   {
+    /**
+     * Computes the Pisano period of m, the length of the cycle that the Fibonacci numbers repeat with mod m
+     * @m: The non-zero modulus
+     *
+     * The period of m is the lcm of the periods of the prime powers dividing it. This takes O(log(m)^2) calls to
+     * fibonacci_mod_pair(), on top of factoring m and each p +- 1. The result is at most 6m, so it wraps for m past
+     * UINTMAX_MAX / 6
+     *
+     * See pisano_prime_power_period
+     */
+    uintmax_t ret = 1, p, last = 0, prime_power = 1, k;
+    if (m == 1) {
+        return 1;
+    }
+    prime_factor_counter pfc = prime_factors(m);
+    do  {
+        p = (!pfc.exhausted) ? next(pfc) : (uintmax_t) -1;
+        if (p != last && last)  {
+            k = pisano_prime_power_period(last, prime_power);
+            ret = ret / gcd(ret, k) * k;
+            prime_power = 1;
+        }
+        last = p;
+        prime_power *= p;
+    } while (p != (uintmax_t) -1);
+    free_prime_factor_counter(pfc);
+    return ret;
+}
+
+bigint fibonacci_bigint(uintmax_t n)    {
+    /**
+     * Computes F(n) exactly by fast doubling, which takes O(log(n)) bigint multiplications
+     * @n: The index of the term you want, with F(0) = 0 and F(1) = 1
+     *
+     * The last few steps dominate, since each one doubles the size of the numbers involved, so this costs about as
+     * much as a few multiplications of F(n)-sized numbers. The caller is responsible for freeing the result
+     *
+     * See bcd_from_bigint
+     */
+    bigint a = new_bigint(0, false), b = new_bigint(1, false), c, d, t, u;
+    uintmax_t mask = ~(UINTMAX_MAX >> 1);
+    for (; mask && !(n & mask); mask >>= 1);
+    for (; mask; mask >>= 1)    {
+        t = add_bigint(b, b);
+        u = sub_bigint(t, a);
+        c = mul_bigint(a, u);  // F(2k)
+        free_bigint(t);
+        free_bigint(u);
+        t = mul_bigint(a, a);
+        u = mul_bigint(b, b);
+        d = add_bigint(t, u);  // F(2k + 1)
+        free_bigint(t);
+        free_bigint(u);
+        free_bigint(a);
+        free_bigint(b);
+        if (n & mask)   {
+            a = d;
+            b = add_bigint(c, d);
+            free_bigint(c);
+        }
+        else    {
+            a = c;
+            b = d;
+        }
+    }
+    free_bigint(b);
+    return a;
+}
+
+typedef struct fibonacci_bcd fibonacci_bcd;
+struct fibonacci_bcd    {
+    /**
+     * The iterator that yields F(1), F(2), F(3), ... as BCD_ints, without allocating a new number for each term
+     * @iterator_function: The function to advance the iterator and return the next element
+     * @exhausted: An indicator that tells you if the iterator is exhausted
+     * @started: An indicator that tells you if the interator has moved at all
+     * @phase: An indicator that flips every time the iterator moves
+     * @current: F(idx), the term most recently yielded
+     * @ahead: F(idx + 1)
+     * @idx: The index of current
+     *
+     * Each step adds ahead into current in place, then swaps the two, so the pair of buffers just ping-pong and only
+     * grow, geometrically, as the terms get longer. Yielded pointers point at current, so they are only good until
+     * the next step, and must not be freed
+     *
+     * See IteratorHead, add_bcd_into
+     */
+    IteratorHead(const BCD_int *, fibonacci_bcd);
+    BCD_int current;
+    BCD_int ahead;
+    uintmax_t idx;
+};
+
+const BCD_int *advance_fibonacci_bcd(fibonacci_bcd *fib);
+inline const BCD_int *advance_fibonacci_bcd(fibonacci_bcd *fib)    {
+    IterationHead(fib);
+    // (current, ahead) is (F(idx), F(idx + 1)), so adding ahead into current leaves F(idx + 2) there
+    add_bcd_into(&fib->current, fib->ahead);
+    BCD_int tmp = fib->current;
+    fib->current = fib->ahead;
+    fib->ahead = tmp;
+    fib->idx++;
+    return &fib->current;
+}
+
+fibonacci_bcd fibonacci_bcd0();
+inline fibonacci_bcd fibonacci_bcd0()   {
+    /**
+     * The constructor for the fibonacci_bcd iterator, which starts from F(0) = 0, so the first term it yields is F(1)
+     *
+     * See fibonacci_bcd
+     */
+    fibonacci_bcd ret;
+    IteratorInitHead(ret, advance_fibonacci_bcd);
+    ret.current = new_BCD_int(0, false);
+    ret.ahead = new_BCD_int(1, false);
+    ret.idx = 0;
+    return ret;
+}
+
+void free_fibonacci_bcd(fibonacci_bcd fib);
+inline void free_fibonacci_bcd(fibonacci_bcd fib)   {
+    free_BCD_int(fib.current);
+    free_BCD_int(fib.ahead);
+}
+
 #endif
@@ -57,6 +57,25 @@
     #define ARM_THUMB 0
 #endif
 
+#if (defined(__SIZEOF_INT128__) && !(PCC_COMPILER || TCC_COMPILER))
+    #define HAS_INT128 1
+#else
+    #define HAS_INT128 0
+#endif
+
+#if (!defined(NO_THREADS) && !defined(_WIN32) && !defined(__STDC_NO_ATOMICS__) && \
+     !(CL_COMPILER || TCC_COMPILER || PCC_COMPILER))
+    #define HAS_PTHREADS 1
+#else
+    #define HAS_PTHREADS 0
+#endif
+
+#if (!defined(NO_SIMD) && X64_COMPILER && (GCC_COMPILER || CLANG_COMPILER || INTEL_COMPILER || AMD_COMPILER))
+    #define HAS_X64_SIMD 1
+#else
+    #define HAS_X64_SIMD 0
+#endif
+
 // compiler workaround section
 
 #if PCC_COMPILER
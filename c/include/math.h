@@ -9,13 +9,186 @@
 
 #include <stdint.h>
 
+unsigned char ctz64(uint64_t x);
+inline unsigned char ctz64(uint64_t x)  {
+    // returns the number of trailing zero bits in x. behaviour is undefined if x is 0
+#if !(CL_COMPILER || TCC_COMPILER || PCC_COMPILER)
+    return __builtin_ctzll(x);
+#else
+    unsigned char answer = 0;
+    while (!(x & 1))    {
+        x >>= 1;
+        ++answer;
+    }
+    return answer;
+#endif
+}
+
+unsigned char clz64(uint64_t x);
+inline unsigned char clz64(uint64_t x)  {
+    // returns the number of leading zero bits in x. behaviour is undefined if x is 0
+#if !(CL_COMPILER || TCC_COMPILER || PCC_COMPILER)
+    return __builtin_clzll(x);
+#else
+    unsigned char answer = 0;
+    while (!(x & 0x8000000000000000ULL))    {
+        x <<= 1;
+        ++answer;
+    }
+    return answer;
+#endif
+}
+
+unsigned char popcount64(uint64_t x);
+inline unsigned char popcount64(uint64_t x) {
+    // returns the number of set bits in x
+#if !(CL_COMPILER || TCC_COMPILER || PCC_COMPILER)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (x * 0x0101010101010101ULL) >> 56;
+#endif
+}
+
+unsigned char count_digits(uint64_t x);
+inline unsigned char count_digits(uint64_t x)   {
+    // returns the number of decimal digits in x, or 0 if x is 0
+    // 1233 / 4096 is just over log10(2), so t is the number of digits or one less, and the table settles which
+    static const uint64_t pow_10[20] = {
+        1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+        10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+        1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+        10000000000000000000ULL
+    };
+    unsigned char t = ((64 - clz64(x | 1)) * 1233) >> 12;
+    return t + (x >= pow_10[t]);
+}
+
+uint64_t mul_64x64(uint64_t a, uint64_t b, uint64_t *hi);
+inline uint64_t mul_64x64(uint64_t a, uint64_t b, uint64_t *hi)  {
+    // returns the low 64 bits of a * b, and stores the high 64 bits in hi
+#if HAS_INT128
+    unsigned __int128 product = (unsigned __int128) a * b;
+    *hi = (uint64_t) (product >> 64);
+    return (uint64_t) product;
+#else
+    uint64_t a_lo = a & 0xFFFFFFFF, a_hi = a >> 32, b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo, lo_hi = a_lo * b_hi, hi_lo = a_hi * b_lo, hi_hi = a_hi * b_hi;
+    uint64_t middle = (lo_lo >> 32) + (lo_hi & 0xFFFFFFFF) + (hi_lo & 0xFFFFFFFF);
+    *hi = hi_hi + (lo_hi >> 32) + (hi_lo >> 32) + (middle >> 32);
+    return (middle << 32) | (lo_lo & 0xFFFFFFFF);
+#endif
+}
+
+uint64_t div_128_64(uint64_t hi, uint64_t lo, uint64_t d, uint64_t *rem);
+inline uint64_t div_128_64(uint64_t hi, uint64_t lo, uint64_t d, uint64_t *rem)   {
+    // returns (hi * 2^64 + lo) / d, and stores the remainder in rem. hi must be less than d, so the quotient fits
+#if HAS_INT128
+    unsigned __int128 n = ((unsigned __int128) hi << 64) | lo;
+    *rem = (uint64_t) (n % d);
+    return (uint64_t) (n / d);
+#else
+    // long division by 32-bit half-digits, as in Hacker's Delight's divlu
+    const uint64_t b = (uint64_t) 1 << 32;
+    unsigned char s = clz64(d);
+    d <<= s;
+    hi = (hi << s) | (s ? lo >> (64 - s) : 0);
+    lo <<= s;
+    uint64_t d1 = d >> 32, d0 = d & 0xFFFFFFFF, l1 = lo >> 32, l0 = lo & 0xFFFFFFFF;
+    uint64_t q1 = hi / d1, r = hi - q1 * d1;
+    while (q1 >= b || q1 * d0 > b * r + l1) {
+        q1--;
+        if ((r += d1) >= b) {
+            break;
+        }
+    }
+    uint64_t mid = hi * b + l1 - q1 * d;
+    uint64_t q0 = mid / d1;
+    r = mid - q0 * d1;
+    while (q0 >= b || q0 * d0 > b * r + l0) {
+        q0--;
+        if ((r += d1) >= b) {
+            break;
+        }
+    }
+    *rem = (mid * b + l0 - q0 * d) >> s;
+    return q1 * b + q0;
+#endif
+}
+
+uint64_t mul_mod(uint64_t a, uint64_t b, uint64_t m);
+inline uint64_t mul_mod(uint64_t a, uint64_t b, uint64_t m)  {
+    // returns a * b mod m. a and b must already be less than m, so the high half of the product is too
+    if ((a | b) <= 0xFFFFFFFF)  {
+        return (a * b) % m;
+    }
+    uint64_t hi, lo = mul_64x64(a, b, &hi), ret;
+    div_128_64(hi, lo, m, &ret);
+    return ret;
+}
+
+uint64_t pow_mod(uint64_t x, uint64_t y, uint64_t m)  {
+    // returns x^y mod m by squaring for each bit of y. m must be non-zero
+    uint64_t answer = 1 % m;
+    x %= m;
+    for (; y; y >>= 1)  {
+        if (y & 1)  {
+            answer = mul_mod(answer, x, m);
+        }
+        x = mul_mod(x, x, m);
+    }
+    return answer;
+}
+
+uint64_t isqrt(uint64_t x)  {
+    // returns floor(sqrt(x)) using Newton's method, so it is exact for all 64-bit inputs
+    if (x < 2)  {
+        return x;
+    }
+    uint64_t r = (uint64_t) 1 << ((64 - clz64(x)) / 2 + 1), next_r;  // always an overestimate
+    while ((next_r = (r + x / r) / 2) < r)  {
+        r = next_r;
+    }
+    return r;
+}
+
+uint64_t gcd(uint64_t a, uint64_t b)    {
+    // binary GCD, which avoids division entirely
+    if (!a || !b)   {
+        return a | b;
+    }
+    unsigned char shift = ctz64(a | b);
+    a >>= ctz64(a);
+    while (b)   {
+        b >>= ctz64(b);
+        if (a > b)  {
+            uint64_t tmp = a;
+            a = b;
+            b = tmp;
+        }
+        b -= a;
+    }
+    return a << shift;
+}
+
 uintmax_t factorial(unsigned int n);
 inline uintmax_t factorial(unsigned int n)  {
     // note that this function only works for numbers smaller than MAX_FACTORIAL_64
+    // see factorial.h for anything bigger
+    static const uint64_t small_factorials[MAX_FACTORIAL_64 + 1] = {
+        1ULL, 1ULL, 2ULL, 6ULL, 24ULL, 120ULL, 720ULL, 5040ULL, 40320ULL, 362880ULL, 3628800ULL, 39916800ULL,
+        479001600ULL, 6227020800ULL, 87178291200ULL, 1307674368000ULL, 20922789888000ULL, 355687428096000ULL,
+        6402373705728000ULL, 121645100408832000ULL, 2432902008176640000ULL
+    };
+    if (n <= MAX_FACTORIAL_64)  {
+        return small_factorials[n];
+    }
     if ((sizeof(uintmax_t) == 8 && n > MAX_FACTORIAL_64) || (sizeof(uintmax_t) == 16 && n > MAX_FACTORIAL_128))
         return -1;
-    uintmax_t ret = 1;
-    for (unsigned int i = 2; i <= n; ++i) {
+    uintmax_t ret = small_factorials[MAX_FACTORIAL_64];
+    for (unsigned int i = MAX_FACTORIAL_64 + 1; i <= n; ++i) {
         ret *= i;
     }
     return ret;
@@ -23,66 +196,25 @@ inline uintmax_t factorial(unsigned int n)  {
 
 uintmax_t n_choose_r(unsigned int n, unsigned int r)    {
     // function returns -1 if it overflows
+    if (r > n)  {
+        return 0;
+    }
     if ((sizeof(uintmax_t) == 8 && n <= MAX_FACTORIAL_64) || (sizeof(uintmax_t) == 16 && n <= MAX_FACTORIAL_128))   {
         // fast path if small enough
         return factorial(n) / factorial(r) / factorial(n-r);
     }
-    // slow path for larger numbers
-    int *factors;
-    uintmax_t answer, tmp;
-    unsigned int i, j;
-    factors = (int *) malloc(sizeof(int) * (n + 1));
-    // collect factors of final number
-    for (i = 2; i <= n; i++) {
-        factors[i] = 1;
-    }
-    // negative factor values indicate need to divide
-    for (i = 2; i <= r; i++) {
-        factors[i] -= 1;
-    }
-    for (i = 2; i <= n - r; i++) {
-        factors[i] -= 1;
-    }
-    // this loop reduces to prime factors only
-    for (i = n; i > 1; i--) {
-        for (j = 2; j < i; j++) {
-            if (i % j == 0) {
-                factors[j] += factors[i];
-                factors[i / j] += factors[i];
-                factors[i] = 0;
-                break;
-            }
-        }
-    }
-    i = j = 2;
-    answer = 1;
-    while (i <= n)  {
-        while (factors[i] > 0)  {
-            tmp = answer;
-            answer *= i;
-            while (answer < tmp && j <= n)  {
-                while (factors[j] < 0)  {
-                    tmp /= j;
-                    factors[j]++;
-                }
-                j++;
-                answer = tmp * i;
-            }
-            if (answer < tmp)   {
-                return -1;  // this indicates an overflow
-            }
-            factors[i]--;
-        }
-        i++;
-    }
-    while (j <= n)  {
-        while (factors[j] < 0)  {
-            answer /= j;
-            factors[j]++;
+    // slow path for larger numbers, building up C(n - r + i, i) = C(n - r + i - 1, i - 1) * (n - r + i) / i, which is
+    // always exact. The product is taken in 128 bits, so this only overflows if a term, and so the answer, does
+    // see binomial.h for exact answers past 64 bits, or modulo prime powers
+    uint64_t answer = 1, hi, lo;
+    r = min(r, n - r);
+    for (unsigned int i = 1; i <= r; i++)   {
+        lo = mul_64x64(answer, n - r + i, &hi);
+        if (hi >= i)    {
+            return -1;  // this indicates an overflow
         }
-        j++;
+        answer = div_128_64(hi, lo, i, &lo);
     }
-    free(factors);
     return answer;
 }
 
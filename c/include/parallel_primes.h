@@ -0,0 +1,544 @@
+#ifndef PARALLEL_PRIMES_H
+#define PARALLEL_PRIMES_H
+
+#include "macros.h"
+#include "iterator.h"
+#include "primes.h"
+#include "prime_counting.h"
+
+#if HAS_PTHREADS
+    #include <pthread.h>
+    #include <unistd.h>
+#endif
+
+#ifndef PARALLEL_SIEVE_UNIT_SEGMENTS
+    #define PARALLEL_SIEVE_UNIT_SEGMENTS 8
+    // the number of L1-sized segments a worker sieves per unit of work, reusing its multiples between them
+#endif
+#ifndef PARALLEL_SIEVE_RING_PER_THREAD
+    #define PARALLEL_SIEVE_RING_PER_THREAD 2
+    // the number of units per worker that the ordered iterator lets workers get ahead of it
+#endif
+#define PARALLEL_SIEVE_UNIT_WORDS (PRIME_SIEVE_SEGMENT_WORDS * PARALLEL_SIEVE_UNIT_SEGMENTS)
+#define PARALLEL_SIEVE_UNIT_SPAN (PRIME_SIEVE_SEGMENT_SPAN * PARALLEL_SIEVE_UNIT_SEGMENTS)
+
+typedef void (*prime_unit_callback)(const uint64_t *composites, size_t bits, uintmax_t low, void *state);
+    /**
+     * The callback type for parallel_prime_reduce()
+     * @composites: The bit-packed sieve state, where bit i is clear if low + 2i is prime
+     * @bits: The number of valid bits in composites. Anything past this is outside the requested range
+     * @low: The odd number represented by the first bit
+     * @state: The state belonging to the calling thread
+     */
+
+typedef struct parallel_sieve_shared parallel_sieve_shared;
+struct parallel_sieve_shared    {
+    /**
+     * The state shared between the workers of a parallel sieve
+     * @low: The odd number represented by the first bit of unit 0
+     * @high: The (exclusive) upper bound of the range being sieved
+     * @primes: The odd reference primes, up to the square root of high
+     * @primes_len: The number of reference primes
+     * @units: The number of units in the range
+     * @next_unit: The next unit that no worker has claimed
+     * @consumed: The number of units the ordered iterator has finished with
+     * @ring: The number of units the ordered iterator buffers ahead of itself
+     * @buffers: The ring of unit buffers used by the ordered iterator
+     * @ready: For each ring slot, one more than the unit that is ready in it, or 0
+     * @stop: An indicator that tells workers to quit early
+     * @callback: The callback that unordered workers call on each unit
+     * @states: The per-thread states given to callback
+     * @state_size: The size of each entry in states
+     * @lock: The mutex protecting next_unit, consumed, ready, and stop
+     * @ready_cond: The condition signalled when a unit becomes ready
+     * @free_cond: The condition signalled when a ring slot becomes free
+     */
+    uintmax_t low;
+    uintmax_t high;
+    uintmax_t *primes;
+    size_t primes_len;
+    size_t units;
+    size_t next_unit;
+    size_t consumed;
+    size_t ring;
+    uint64_t *buffers;
+    size_t *ready;
+    bool stop;
+    prime_unit_callback callback;
+    unsigned char *states;
+    size_t state_size;
+#if HAS_PTHREADS
+    pthread_mutex_t lock;
+    pthread_cond_t ready_cond;
+    pthread_cond_t free_cond;
+#endif
+};
+
+typedef struct parallel_sieve_worker parallel_sieve_worker;
+struct parallel_sieve_worker    {
+    /**
+     * The per-thread state of a parallel sieve worker
+     * @shared: The state shared with the other workers
+     * @idx: The index of this worker, which picks its entry in shared->states
+     * @thread: The thread running this worker
+     */
+    parallel_sieve_shared *shared;
+    size_t idx;
+#if HAS_PTHREADS
+    pthread_t thread;
+#endif
+};
+
+unsigned parallel_sieve_threads()    {
+    /**
+     * Returns the number of worker threads to use when the caller asks for 0
+     */
+#if HAS_PTHREADS && defined(_SC_NPROCESSORS_ONLN)
+    long ret = sysconf(_SC_NPROCESSORS_ONLN);
+    return (ret > 0) ? (unsigned) ret : 1;
+#else
+    return 1;
+#endif
+}
+
+void init_parallel_sieve_shared(parallel_sieve_shared *shared, uintmax_t lo, uintmax_t hi)    {
+    /**
+     * Sets up the reference primes and unit layout for sieving [lo, hi)
+     * @shared: The state you want to initialize
+     * @lo: The (inclusive) lower bound of the range
+     * @hi: The (exclusive) upper bound of the range
+     */
+    size_t primes_size = 64;
+    uintmax_t p;
+    prime_sieve ps = prime_sieve0();
+    shared->low = (lo < 1) ? 1 : (lo | 1);
+    shared->high = hi;
+    shared->units = (hi > shared->low) ? (hi - shared->low - 1) / PARALLEL_SIEVE_UNIT_SPAN + 1 : 0;
+    shared->next_unit = shared->consumed = shared->ring = 0;
+    shared->buffers = NULL;
+    shared->ready = NULL;
+    shared->stop = false;
+    shared->callback = NULL;
+    shared->states = NULL;
+    shared->state_size = 0;
+    shared->primes = (uintmax_t *) malloc(primes_size * sizeof(uintmax_t));
+    shared->primes_len = 0;
+    next(ps);  // skip 2, since only odd numbers are sieved
+    for (p = next(ps); p <= hi / p; p = next(ps))   {
+        if (shared->primes_len == primes_size)  {
+            primes_size *= 2;
+            shared->primes = (uintmax_t *) realloc(shared->primes, primes_size * sizeof(uintmax_t));
+        }
+        shared->primes[shared->primes_len++] = p;
+    }
+    free_prime_sieve(ps);
+#if HAS_PTHREADS
+    pthread_mutex_init(&shared->lock, NULL);
+    pthread_cond_init(&shared->ready_cond, NULL);
+    pthread_cond_init(&shared->free_cond, NULL);
+#endif
+}
+
+void free_parallel_sieve_shared(parallel_sieve_shared *shared)  {
+    /**
+     * Releases the storage held by a parallel sieve's shared state. No workers may still be running
+     * @shared: The state you want to free
+     */
+    free(shared->primes);
+    free(shared->buffers);
+    free(shared->ready);
+#if HAS_PTHREADS
+    pthread_mutex_destroy(&shared->lock);
+    pthread_cond_destroy(&shared->ready_cond);
+    pthread_cond_destroy(&shared->free_cond);
+#endif
+}
+
+size_t sieve_parallel_unit(const parallel_sieve_shared *shared, size_t unit, uint64_t *buffer, uintmax_t *multiples)  {
+    /**
+     * Sieves one unit of a parallel sieve, one L1-sized segment at a time
+     * @shared: The shared sieve state
+     * @unit: The index of the unit to sieve
+     * @buffer: Where to put the bit-packed result, which must have room for PARALLEL_SIEVE_UNIT_WORDS words
+     * @multiples: Scratch space with room for shared->primes_len numbers
+     *
+     * Returns the number of valid bits in the unit
+     */
+    uintmax_t low = shared->low + unit * PARALLEL_SIEVE_UNIT_SPAN, high = low + PARALLEL_SIEVE_UNIT_SPAN;
+    size_t len = 0;
+    if (high > shared->high)    {
+        high = shared->high;
+    }
+    for (; len < shared->primes_len && shared->primes[len] * shared->primes[len] < high; len++)  {
+        multiples[len] = first_odd_multiple(shared->primes[len], low);
+    }
+    for (size_t j = 0; j < PARALLEL_SIEVE_UNIT_SEGMENTS; j++)  {
+        sieve_segment(
+            buffer + j * PRIME_SIEVE_SEGMENT_WORDS, PRIME_SIEVE_SEGMENT_WORDS,
+            low + j * PRIME_SIEVE_SEGMENT_SPAN, shared->primes, multiples, len
+        );
+    }
+    return (high - low + 1) / 2;
+}
+
+#if HAS_PTHREADS
+    #define parallel_sieve_lock(shared) pthread_mutex_lock(&(shared)->lock)
+    #define parallel_sieve_unlock(shared) pthread_mutex_unlock(&(shared)->lock)
+#else
+    #define parallel_sieve_lock(shared)
+    #define parallel_sieve_unlock(shared)
+#endif
+
+void *parallel_sieve_reduce_worker(void *arg)    {
+    /**
+     * The worker loop for parallel_prime_reduce(), which claims units in any order
+     * @arg: The parallel_sieve_worker for this thread
+     */
+    parallel_sieve_worker *worker = (parallel_sieve_worker *) arg;
+    parallel_sieve_shared *shared = worker->shared;
+    void *state = shared->states + worker->idx * shared->state_size;
+    uint64_t *buffer = (uint64_t *) malloc(PARALLEL_SIEVE_UNIT_WORDS * sizeof(uint64_t));
+    uintmax_t *multiples = (uintmax_t *) malloc((shared->primes_len + 1) * sizeof(uintmax_t));
+    while (true)    {
+        parallel_sieve_lock(shared);
+        size_t unit = shared->next_unit++;
+        parallel_sieve_unlock(shared);
+        if (unit >= shared->units)  {
+            break;
+        }
+        size_t bits = sieve_parallel_unit(shared, unit, buffer, multiples);
+        shared->callback(buffer, bits, shared->low + unit * PARALLEL_SIEVE_UNIT_SPAN, state);
+    }
+    free(buffer);
+    free(multiples);
+    return NULL;
+}
+
+void parallel_prime_reduce(uintmax_t lo, uintmax_t hi, unsigned threads, prime_unit_callback callback, void *states, size_t state_size)    {
+    /**
+     * Sieves [lo, hi) across a pool of worker threads, handing each unit to a callback in no particular order
+     * @lo: The (inclusive) lower bound of the range
+     * @hi: The (exclusive) upper bound of the range
+     * @threads: The number of worker threads, or 0 to use parallel_sieve_threads()
+     * @callback: The function to call on each sieved unit
+     * @states: An array of per-thread states, which must have room for one per worker thread
+     * @state_size: The size of each entry in states
+     *
+     * Each worker only ever passes its own state to callback, so states need no locking. Combining them is
+     * left to the caller. Note that 2 is never reported, since only odd numbers are sieved.
+     *
+     * Without pthreads this runs everything on the calling thread with states[0]
+     */
+    parallel_sieve_shared shared;
+    init_parallel_sieve_shared(&shared, lo, hi);
+    shared.callback = callback;
+    shared.states = (unsigned char *) states;
+    shared.state_size = state_size;
+#if HAS_PTHREADS
+    if (!threads)   {
+        threads = parallel_sieve_threads();
+    }
+    parallel_sieve_worker *workers = (parallel_sieve_worker *) malloc(threads * sizeof(parallel_sieve_worker));
+    for (unsigned i = 0; i < threads; i++)  {
+        workers[i].shared = &shared;
+        workers[i].idx = i;
+        pthread_create(&workers[i].thread, NULL, &parallel_sieve_reduce_worker, &workers[i]);
+    }
+    for (unsigned i = 0; i < threads; i++)  {
+        pthread_join(workers[i].thread, NULL);
+    }
+    free(workers);
+#else
+    parallel_sieve_worker worker = {&shared, 0};
+    (void) threads;
+    parallel_sieve_reduce_worker(&worker);
+#endif
+    free_parallel_sieve_shared(&shared);
+}
+
+void count_primes_in_unit(const uint64_t *composites, size_t bits, uintmax_t low, void *state)    {
+    /**
+     * The prime_unit_callback behind parallel_prime_count(), which adds to a prime_sum_t
+     *
+     * See prime_unit_callback
+     */
+    uintmax_t count = 0;
+    size_t i;
+    for (i = 0; i < bits / 64; i++) {
+        count += popcount64(~composites[i]);
+    }
+    if (bits % 64)  {
+        count += popcount64(~composites[i] & (((uint64_t) 1 << (bits % 64)) - 1));
+    }
+    *(prime_sum_t *) state += count;
+}
+
+void sum_primes_in_unit(const uint64_t *composites, size_t bits, uintmax_t low, void *state)  {
+    /**
+     * The prime_unit_callback behind parallel_prime_sum(), which adds to a prime_sum_t
+     *
+     * See prime_unit_callback
+     */
+    prime_sum_t sum = 0;
+    for (size_t i = 0; i * 64 < bits; i++)  {
+        uint64_t primes = ~composites[i];
+        if (bits - i * 64 < 64) {
+            primes &= ((uint64_t) 1 << (bits - i * 64)) - 1;
+        }
+        while (primes)  {
+            sum += low + (i * 64 + ctz64(primes)) * 2;
+            primes &= primes - 1;
+        }
+    }
+    *(prime_sum_t *) state += sum;
+}
+
+prime_sum_t parallel_prime_reduce_total(uintmax_t lo, uintmax_t hi, unsigned threads, prime_unit_callback callback)  {
+    /**
+     * Runs parallel_prime_reduce() with one prime_sum_t per thread, and adds them together
+     */
+#if HAS_PTHREADS
+    if (!threads)   {
+        threads = parallel_sieve_threads();
+    }
+#else
+    threads = 1;
+#endif
+    prime_sum_t *states = (prime_sum_t *) calloc(threads, sizeof(prime_sum_t)), ret = 0;
+    parallel_prime_reduce(lo, hi, threads, callback, states, sizeof(prime_sum_t));
+    for (unsigned i = 0; i < threads; i++)  {
+        ret += states[i];
+    }
+    free(states);
+    return ret;
+}
+
+uintmax_t parallel_prime_count(uintmax_t lo, uintmax_t hi, unsigned threads);
+inline uintmax_t parallel_prime_count(uintmax_t lo, uintmax_t hi, unsigned threads)  {
+    /**
+     * Counts the primes in [lo, hi) using a pool of worker threads
+     * @lo: The (inclusive) lower bound of the range
+     * @hi: The (exclusive) upper bound of the range
+     * @threads: The number of worker threads, or 0 to use parallel_sieve_threads()
+     */
+    return (lo <= 2 && hi > 2) + (uintmax_t) parallel_prime_reduce_total(lo, hi, threads, &count_primes_in_unit);
+}
+
+prime_sum_t parallel_prime_sum(uintmax_t lo, uintmax_t hi, unsigned threads);
+inline prime_sum_t parallel_prime_sum(uintmax_t lo, uintmax_t hi, unsigned threads)  {
+    /**
+     * Sums the primes in [lo, hi) using a pool of worker threads
+     * @lo: The (inclusive) lower bound of the range
+     * @hi: The (exclusive) upper bound of the range
+     * @threads: The number of worker threads, or 0 to use parallel_sieve_threads()
+     *
+     * Each unit and each thread adds up in a prime_sum_t, so with 128-bit integers the sum up to 10^11 (about 2e20)
+     * comes out exact. Without them, it wraps around once the sum passes UINTMAX_MAX, a little past hi = 10^10
+     */
+    return 2 * (lo <= 2 && hi > 2) + parallel_prime_reduce_total(lo, hi, threads, &sum_primes_in_unit);
+}
+
+void *parallel_sieve_ordered_worker(void *arg)   {
+    /**
+     * The worker loop for parallel_prime_sieve, which fills the ring in unit order
+     * @arg: The parallel_sieve_worker for this thread
+     */
+    parallel_sieve_shared *shared = ((parallel_sieve_worker *) arg)->shared;
+    uintmax_t *multiples = (uintmax_t *) malloc((shared->primes_len + 1) * sizeof(uintmax_t));
+#if HAS_PTHREADS
+    pthread_mutex_lock(&shared->lock);
+    while (true)    {
+        while (!shared->stop && shared->next_unit < shared->units && shared->next_unit >= shared->consumed + shared->ring)  {
+            pthread_cond_wait(&shared->free_cond, &shared->lock);
+        }
+        if (shared->stop || shared->next_unit >= shared->units)  {
+            break;
+        }
+        size_t unit = shared->next_unit++, slot = unit % shared->ring;
+        pthread_mutex_unlock(&shared->lock);
+        sieve_parallel_unit(shared, unit, shared->buffers + slot * PARALLEL_SIEVE_UNIT_WORDS, multiples);
+        pthread_mutex_lock(&shared->lock);
+        shared->ready[slot] = unit + 1;
+        pthread_cond_broadcast(&shared->ready_cond);
+    }
+    pthread_mutex_unlock(&shared->lock);
+#endif
+    free(multiples);
+    return NULL;
+}
+
+typedef struct parallel_prime_sieve parallel_prime_sieve;
+struct parallel_prime_sieve {
+    /**
+     * The iterator that yields primes in ascending order while a pool of workers sieves ahead of it
+     * @iterator_function: The function to advance the iterator and return the next element
+     * @exhausted: An indicator that tells you if the iterator is exhausted
+     * @started: An indicator that tells you if the interator has moved at all
+     * @phase: An indicator that flips every time the iterator moves
+     * @shared: The state shared with the workers
+     * @workers: The worker threads, or NULL if the iterator sieves for itself
+     * @threads: The number of worker threads
+     * @two: An indicator that 2 is in range and has not been yielded yet
+     * @unit: The unit currently being read
+     * @buffer: The sieve state of the current unit, or NULL if it has not arrived yet
+     * @bits: The number of valid bits in buffer
+     * @idx: The bit index of the next candidate in buffer
+     * @multiples: Scratch space used when the iterator sieves for itself
+     *
+     * See IteratorHead
+     */
+    IteratorHead(uintmax_t, parallel_prime_sieve);
+    parallel_sieve_shared *shared;
+    parallel_sieve_worker *workers;
+    unsigned threads;
+    bool two;
+    size_t unit;
+    const uint64_t *buffer;
+    size_t bits;
+    size_t idx;
+    uintmax_t *multiples;
+};
+
+uintmax_t advance_parallel_prime_sieve(parallel_prime_sieve *pps)    {
+    /**
+     * The function to advance a parallel prime sieve iterator
+     * @pps: The sieve you want to advance
+     *
+     * Returns the next prime number in the iteration, or 0 once it is exhausted
+     */
+    IterationHead(pps);
+    parallel_sieve_shared *shared = pps->shared;
+    if (pps->two)   {
+        pps->two = false;
+        return 2;
+    }
+    while (true)    {
+        if (pps->buffer != NULL)    {
+            for (size_t word = pps->idx / 64; word * 64 < pps->bits; word++)    {
+                uint64_t candidates = ~pps->buffer[word];
+                if (word == pps->idx / 64)  {
+                    candidates &= ~(uint64_t) 0 << (pps->idx % 64);
+                }
+                if (candidates) {
+                    size_t bit = word * 64 + ctz64(candidates);
+                    if (bit >= pps->bits)   {
+                        break;
+                    }
+                    pps->idx = bit + 1;
+                    return shared->low + pps->unit * PARALLEL_SIEVE_UNIT_SPAN + bit * 2;
+                }
+            }
+            // done with this unit, so hand its slot back to the workers
+            pps->buffer = NULL;
+            parallel_sieve_lock(shared);
+            shared->consumed = ++pps->unit;
+#if HAS_PTHREADS
+            pthread_cond_broadcast(&shared->free_cond);
+#endif
+            parallel_sieve_unlock(shared);
+        }
+        if (pps->unit >= shared->units) {
+            pps->exhausted = true;
+            return 0;
+        }
+        size_t slot = pps->unit % shared->ring;
+        uint64_t *buffer = shared->buffers + slot * PARALLEL_SIEVE_UNIT_WORDS;
+        if (pps->workers == NULL)   {
+            pps->bits = sieve_parallel_unit(shared, pps->unit, buffer, pps->multiples);
+        } else  {
+#if HAS_PTHREADS
+            pthread_mutex_lock(&shared->lock);
+            while (shared->ready[slot] != pps->unit + 1)   {
+                pthread_cond_wait(&shared->ready_cond, &shared->lock);
+            }
+            pthread_mutex_unlock(&shared->lock);
+#endif
+            uintmax_t low = shared->low + pps->unit * PARALLEL_SIEVE_UNIT_SPAN, high = low + PARALLEL_SIEVE_UNIT_SPAN;
+            pps->bits = (min(high, shared->high) - low + 1) / 2;
+        }
+        pps->buffer = buffer;
+        pps->idx = 0;
+    }
+}
+
+parallel_prime_sieve parallel_prime_sieve3(uintmax_t lo, uintmax_t hi, unsigned threads)   {
+    /**
+     * The constructor for the parallel prime sieve
+     * @lo: The (inclusive) lower bound of the range
+     * @hi: The (exclusive) upper bound of the range
+     * @threads: The number of worker threads, or 0 to use parallel_sieve_threads()
+     *
+     * Without pthreads, the iterator sieves each unit itself when it gets to it
+     *
+     * See parallel_prime_sieve
+     */
+    parallel_prime_sieve ret;
+    IteratorInitHead(ret, advance_parallel_prime_sieve);
+    ret.shared = (parallel_sieve_shared *) malloc(sizeof(parallel_sieve_shared));
+    init_parallel_sieve_shared(ret.shared, lo, hi);
+    ret.two = (lo <= 2 && hi > 2);
+    ret.unit = ret.bits = ret.idx = 0;
+    ret.buffer = NULL;
+    ret.workers = NULL;
+    ret.multiples = NULL;
+#if HAS_PTHREADS
+    ret.threads = threads ? threads : parallel_sieve_threads();
+#else
+    ret.threads = 0;
+#endif
+    if (ret.threads)    {
+        ret.shared->ring = ret.threads * PARALLEL_SIEVE_RING_PER_THREAD;
+        ret.shared->ready = (size_t *) calloc(ret.shared->ring, sizeof(size_t));
+    } else  {
+        ret.shared->ring = 1;
+        ret.multiples = (uintmax_t *) malloc((ret.shared->primes_len + 1) * sizeof(uintmax_t));
+    }
+    ret.shared->buffers = (uint64_t *) malloc(ret.shared->ring * PARALLEL_SIEVE_UNIT_WORDS * sizeof(uint64_t));
+#if HAS_PTHREADS
+    if (ret.threads)    {
+        ret.workers = (parallel_sieve_worker *) malloc(ret.threads * sizeof(parallel_sieve_worker));
+        for (unsigned i = 0; i < ret.threads; i++)  {
+            ret.workers[i].shared = ret.shared;
+            ret.workers[i].idx = i;
+            pthread_create(&ret.workers[i].thread, NULL, &parallel_sieve_ordered_worker, &ret.workers[i]);
+        }
+    }
+#endif
+    return ret;
+}
+
+parallel_prime_sieve parallel_prime_sieve2(uintmax_t lo, uintmax_t hi);
+inline parallel_prime_sieve parallel_prime_sieve2(uintmax_t lo, uintmax_t hi)    {
+    /**
+     * The simpler constructor for the parallel prime sieve, which uses parallel_sieve_threads() workers
+     * @lo: The (inclusive) lower bound of the range
+     * @hi: The (exclusive) upper bound of the range
+     *
+     * See parallel_prime_sieve
+     */
+    return parallel_prime_sieve3(lo, hi, 0);
+}
+
+void free_parallel_prime_sieve(parallel_prime_sieve pps)    {
+    /**
+     * Stops the workers of a parallel prime sieve and releases its storage
+     * @pps: The sieve you want to free
+     */
+#if HAS_PTHREADS
+    if (pps.workers != NULL)    {
+        pthread_mutex_lock(&pps.shared->lock);
+        pps.shared->stop = true;
+        pthread_cond_broadcast(&pps.shared->free_cond);
+        pthread_mutex_unlock(&pps.shared->lock);
+        for (unsigned i = 0; i < pps.threads; i++)  {
+            pthread_join(pps.workers[i].thread, NULL);
+        }
+        free(pps.workers);
+    }
+#endif
+    free(pps.multiples);
+    free_parallel_sieve_shared(pps.shared);
+    free(pps.shared);
+}
+
+#endif
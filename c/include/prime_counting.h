@@ -0,0 +1,192 @@
+#ifndef PRIME_COUNTING_H
+#define PRIME_COUNTING_H
+
+#include "macros.h"
+#include "math.h"
+#include "primes.h"
+
+#if HAS_INT128
+    typedef unsigned __int128 prime_sum_t;
+#else
+    typedef uintmax_t prime_sum_t;
+    // note: without 128-bit integers, prime_sum() wraps around once the sum passes UINTMAX_MAX, a little past 10^10
+#endif
+
+uint64_t div_by_reciprocal(uint64_t n, uint64_t d, double inverse);
+inline uint64_t div_by_reciprocal(uint64_t n, uint64_t d, double inverse)   {
+    /**
+     * Divides using a precomputed floating point reciprocal, which is much cheaper than a 64-bit division
+     * @n: The dividend
+     * @d: The divisor
+     * @inverse: 1.0 / d
+     *
+     * Returns floor(n / d), corrected for any rounding in the floating point estimate
+     */
+    uint64_t q = (uint64_t) (n * inverse);
+    while (q * d > n)   {
+        q--;
+    }
+    while (n - q * d >= d)  {
+        q++;
+    }
+    return q;
+}
+
+uint64_t *init_prime_counting_roughs(uint64_t r, size_t *len)   {
+    /**
+     * Builds the list of indices into the large table that prime_pi() and prime_sum() still need to update
+     * @r: The square root of the number being counted up to
+     * @len: Where to store the length of the list
+     *
+     * The list starts as every odd number up to r. large[i] is only ever read again if i has no prime factors
+     * below the current prime, so each step removes the multiples of its prime, as well as any index that has
+     * grown past x / p^2 and so will never be updated again.
+     */
+    uint64_t *roughs = (uint64_t *) malloc(((r + 1) / 2 + 1) * sizeof(uint64_t));
+    *len = 0;
+    for (uint64_t i = 1; i <= r; i += 2)    {
+        roughs[(*len)++] = i;
+    }
+    return roughs;
+}
+
+void sift_prime_counting_roughs(uint64_t *roughs, size_t *len, bool *skip, uint64_t r, uint64_t p, uint64_t limit)  {
+    /**
+     * Removes the multiples of p, and everything past limit, from the list built by init_prime_counting_roughs()
+     * @roughs: The list of indices
+     * @len: The length of the list, which will be updated
+     * @skip: A table of which odd numbers up to r have already been removed
+     * @r: The square root of the number being counted up to
+     * @p: The prime that was just processed
+     * @limit: The largest index that the next step could update
+     */
+    size_t kept = 0;
+    for (uint64_t m = p; m <= r; m += 2 * p)    {
+        skip[m] = true;
+    }
+    for (size_t k = 0; k < *len && roughs[k] <= limit; k++) {
+        if (!skip[roughs[k]])   {
+            roughs[kept++] = roughs[k];
+        }
+    }
+    *len = kept;
+}
+
+uintmax_t prime_pi(uintmax_t x)    {
+    /**
+     * Counts the primes less than or equal to x, using the Lucy_Hedgehog variant of Legendre's method
+     * @x: The number you want to count up to
+     *
+     * small[v] holds the count for v <= sqrt(x), and large[i] holds the count for x / i. Each odd prime p up to
+     * sqrt(x) removes the numbers whose smallest prime factor is p. Even numbers are never counted in the first
+     * place, and only the entries of large that large[1] still depends on are updated. This takes roughly
+     * O(x^(3/4) / log(x)) time and O(sqrt(x)) memory.
+     */
+    if (x < 2)  {
+        return 0;
+    }
+    uint64_t r = isqrt(x), p;
+    size_t roughs_len;
+    uint64_t *small = (uint64_t *) malloc((r + 1) * sizeof(uint64_t));
+    uint64_t *large = (uint64_t *) malloc((r + 1) * sizeof(uint64_t));
+    uint64_t *roughs = init_prime_counting_roughs(r, &roughs_len);
+    bool *skip = (bool *) calloc(r + 1, sizeof(bool));
+    // start with 2 and every odd number from 3 up
+    small[0] = small[1] = 0;
+    for (uint64_t v = 2; v <= r; v++)   {
+        small[v] = (v + 1) / 2;
+    }
+    for (uint64_t i = 1; i <= r; i += 2)    {
+        large[i] = (x / i + 1) / 2;
+    }
+    prime_sieve ps = prime_sieve0();
+    next(ps);  // 2 was never counted against, so skip it
+    for (p = next(ps); p * p <= x; p = next(ps))    {
+        uint64_t below_p = small[p - 1], limit = min(r, x / (p * p));
+        double inverse = 1.0 / (double) p;
+        for (size_t k = 0; k < roughs_len && roughs[k] <= limit; k++)  {
+            uint64_t i = roughs[k], d = i * p;
+            if (d <= r) {
+                large[i] -= large[d] - below_p;
+            } else  {
+                large[i] -= small[div_by_reciprocal(x / i, p, inverse)] - below_p;
+            }
+        }
+        for (uint64_t j = r / p; j >= p; j--)   {  // v / p is constant across each block of p values of v
+            uint64_t c = small[j] - below_p, end = min(j * p + p - 1, r);
+            for (uint64_t v = j * p; v <= end; v++) {
+                small[v] -= c;
+            }
+        }
+        sift_prime_counting_roughs(roughs, &roughs_len, skip, r, p, limit);
+    }
+    uintmax_t ret = large[1];
+    free_prime_sieve(ps);
+    free(small);
+    free(large);
+    free(roughs);
+    free(skip);
+    return ret;
+}
+
+prime_sum_t prime_sum(uintmax_t x) {
+    /**
+     * Sums the primes less than or equal to x, using the Lucy_Hedgehog variant of Legendre's method
+     * @x: The number you want to sum up to
+     *
+     * This works exactly like prime_pi(), except that each number is weighted by itself.
+     *
+     * See prime_pi
+     */
+    if (x < 2)  {
+        return 0;
+    }
+    uint64_t r = isqrt(x), p;
+    size_t roughs_len;
+    prime_sum_t *small = (prime_sum_t *) malloc((r + 1) * sizeof(prime_sum_t));
+    prime_sum_t *large = (prime_sum_t *) malloc((r + 1) * sizeof(prime_sum_t));
+    uint64_t *roughs = init_prime_counting_roughs(r, &roughs_len);
+    bool *skip = (bool *) calloc(r + 1, sizeof(bool));
+    // start with 2 and every odd number from 3 up. There are k = (v + 1) / 2 odd numbers up to v, summing to k^2
+    small[0] = small[1] = 0;
+    for (uint64_t v = 2; v <= r; v++)   {
+        prime_sum_t k = (v + 1) / 2;
+        small[v] = k * k + 1;
+    }
+    for (uint64_t i = 1; i <= r; i += 2)    {
+        prime_sum_t k = (x / i + 1) / 2;
+        large[i] = k * k + 1;
+    }
+    prime_sieve ps = prime_sieve0();
+    next(ps);  // 2 was never counted against, so skip it
+    for (p = next(ps); p * p <= x; p = next(ps))    {
+        uint64_t limit = min(r, x / (p * p));
+        prime_sum_t below_p = small[p - 1];
+        double inverse = 1.0 / (double) p;
+        for (size_t k = 0; k < roughs_len && roughs[k] <= limit; k++)  {
+            uint64_t i = roughs[k], d = i * p;
+            if (d <= r) {
+                large[i] -= p * (large[d] - below_p);
+            } else  {
+                large[i] -= p * (small[div_by_reciprocal(x / i, p, inverse)] - below_p);
+            }
+        }
+        for (uint64_t j = r / p; j >= p; j--)   {
+            prime_sum_t c = p * (small[j] - below_p);
+            uint64_t end = min(j * p + p - 1, r);
+            for (uint64_t v = j * p; v <= end; v++) {
+                small[v] -= c;
+            }
+        }
+        sift_prime_counting_roughs(roughs, &roughs_len, skip, r, p, limit);
+    }
+    prime_sum_t ret = large[1];
+    free_prime_sieve(ps);
+    free(small);
+    free(large);
+    free(roughs);
+    free(skip);
+    return ret;
+}
+
+#endif
@@ -3,7 +3,9 @@
 
 #include <stdint.h>
 #include <inttypes.h>
+#include <string.h>
 #include "macros.h"
+#include "math.h"
 
 #if !PCC_COMPILER
     #include <stdlib.h>
@@ -14,6 +16,189 @@
 
 #include "iterator.h"
 
+#if HAS_PTHREADS
+    #include <pthread.h>
+    #include <stdatomic.h>
+    #define prime_cache_load_len(cache) atomic_load_explicit(&(cache)->len, memory_order_acquire)
+    #define prime_cache_store_len(cache, value) atomic_store_explicit(&(cache)->len, value, memory_order_release)
+    #define prime_cache_lock(cache) pthread_mutex_lock(&(cache)->lock)
+    #define prime_cache_unlock(cache) pthread_mutex_unlock(&(cache)->lock)
+#else
+    #define prime_cache_load_len(cache) ((cache)->len)
+    #define prime_cache_store_len(cache, value) ((cache)->len = (value))
+    #define prime_cache_lock(cache)
+    #define prime_cache_unlock(cache)
+#endif
+
+// the cache is stored in chunks that double in size, so it never has to move primes that readers might be using
+#define PRIME_CACHE_CHUNK_BITS 6
+#define PRIME_CACHE_CHUNKS (64 - PRIME_CACHE_CHUNK_BITS)
+
+typedef struct prime_cache prime_cache;
+struct prime_cache  {
+    /**
+     * A growable list of the prime numbers, in order, which can be shared between threads
+     * @lock: The mutex held by whichever thread is extending the cache
+     * @len: The number of primes in the cache, published only after they are written
+     * @limit: The most primes this cache is allowed to hold (at least 4), or 0 for no limit
+     * @chunks: The storage for the cache, where chunk k holds 2^(PRIME_CACHE_CHUNK_BITS + k) primes
+     *
+     * Readers never take the lock. They load len, and every prime below that index is safe to read, even
+     * while another thread is extending the cache.
+     */
+#if HAS_PTHREADS
+    pthread_mutex_t lock;
+    atomic_size_t len;
+#else
+    size_t len;
+#endif
+    size_t limit;
+    uintmax_t *chunks[PRIME_CACHE_CHUNKS];
+};
+
+// note: If you let it, this will grow indefinitely. To not let it do so, #define PRIME_CACHE_SIZE_LIMIT
+#ifndef PRIME_CACHE_SIZE_LIMIT
+    #define PRIME_CACHE_SIZE_LIMIT 0
+#endif
+
+#if HAS_PTHREADS
+    prime_cache global_prime_cache = {PTHREAD_MUTEX_INITIALIZER, 0, PRIME_CACHE_SIZE_LIMIT};
+#else
+    prime_cache global_prime_cache = {0, PRIME_CACHE_SIZE_LIMIT};
+#endif
+
+void init_prime_cache(prime_cache *cache, size_t limit)    {
+    /**
+     * Initializes an empty prime cache
+     * @cache: The cache you want to initialize
+     * @limit: The most primes this cache is allowed to hold (at least 4), or 0 for no limit
+     *
+     * See prime_cache
+     */
+#if HAS_PTHREADS
+    pthread_mutex_init(&cache->lock, NULL);
+    atomic_init(&cache->len, 0);
+#else
+    cache->len = 0;
+#endif
+    cache->limit = limit;
+    memset(cache->chunks, 0, sizeof(cache->chunks));
+}
+
+void free_prime_cache(prime_cache *cache)   {
+    /**
+     * Releases the storage held by a prime cache. No other threads may be using it
+     * @cache: The cache you want to free
+     */
+    for (size_t k = 0; k < PRIME_CACHE_CHUNKS; k++) {
+        free(cache->chunks[k]);
+        cache->chunks[k] = NULL;
+    }
+    prime_cache_store_len(cache, 0);
+#if HAS_PTHREADS
+    if (cache != &global_prime_cache)   {
+        pthread_mutex_destroy(&cache->lock);
+    }
+#endif
+}
+
+uintmax_t *prime_cache_slot(prime_cache *cache, size_t idx);
+inline uintmax_t *prime_cache_slot(prime_cache *cache, size_t idx)  {
+    /**
+     * Finds where a given prime is stored in the cache
+     * @cache: The cache you want to look in
+     * @idx: The index of the prime, which must already have a chunk allocated
+     */
+    uint64_t j = (uint64_t) idx + ((uint64_t) 1 << PRIME_CACHE_CHUNK_BITS);
+    unsigned char k = 63 - clz64(j) - PRIME_CACHE_CHUNK_BITS;
+    return cache->chunks[k] + (j - ((uint64_t) 1 << (PRIME_CACHE_CHUNK_BITS + k)));
+}
+
+uintmax_t next_uncached_prime(prime_cache *cache, size_t len, uintmax_t p)  {
+    /**
+     * Finds the next prime by trial division against the cache
+     * @cache: The cache to divide by
+     * @len: The number of primes in the cache, which must be at least 2
+     * @p: The odd prime to start after
+     *
+     * If the cache runs out before the square root of a candidate, it falls back to odd divisors
+     */
+    while (true)    {
+        bool broken = false;
+        size_t idx;
+        uintmax_t q = 3;
+        p += 2;
+        for (idx = 1; idx < len; idx++)  {  // skip 2, since candidates are odd
+            q = *prime_cache_slot(cache, idx);
+            if (q > p / q)  {
+                break;
+            }
+            if (p % q == 0) {  // is not prime
+                broken = true;
+                break;
+            }
+        }
+        if (!broken && idx == len)  {  // primeness not determined, exceeded cache
+            for (q += 2; q <= p / q; q += 2)    {
+                if (p % q == 0) {  // is not prime
+                    broken = true;
+                    break;
+                }
+            }
+        }
+        if (!broken)    {
+            return p;
+        }
+    }
+}
+
+bool extend_prime_cache(prime_cache *cache, size_t len) {
+    /**
+     * Grows a prime cache until it holds at least len primes
+     * @cache: The cache you want to extend
+     * @len: The number of primes you need
+     *
+     * Only one thread extends a cache at a time, but readers are never blocked. Returns false if the cache
+     * would exceed its limit (in which case it is filled to the limit) or runs out of memory
+     */
+    bool ret = true;
+    if (cache->limit && len > cache->limit) {
+        len = cache->limit;
+        ret = false;
+    }
+    prime_cache_lock(cache);
+    size_t cur = prime_cache_load_len(cache);
+    if (!cur)   {  // if not already done, initialize the prime cache
+        cache->chunks[0] = (uintmax_t *) malloc(sizeof(uintmax_t) << PRIME_CACHE_CHUNK_BITS);
+        if (cache->chunks[0] == NULL)   {
+            prime_cache_unlock(cache);
+            return false;
+        }
+        cache->chunks[0][0] = 2;
+        cache->chunks[0][1] = 3;
+        cache->chunks[0][2] = 5;
+        cache->chunks[0][3] = 7;
+        prime_cache_store_len(cache, cur = 4);
+    }
+    uintmax_t p = *prime_cache_slot(cache, cur - 1);
+    for (; cur < len; cur++)    {
+        uint64_t j = (uint64_t) cur + ((uint64_t) 1 << PRIME_CACHE_CHUNK_BITS);
+        unsigned char k = 63 - clz64(j) - PRIME_CACHE_CHUNK_BITS;
+        if (cache->chunks[k] == NULL)   {
+            cache->chunks[k] = (uintmax_t *) malloc(sizeof(uintmax_t) << (PRIME_CACHE_CHUNK_BITS + k));
+            if (cache->chunks[k] == NULL)   {
+                prime_cache_unlock(cache);
+                return false;
+            }
+        }
+        p = next_uncached_prime(cache, cur, p);
+        *prime_cache_slot(cache, cur) = p;
+        prime_cache_store_len(cache, cur + 1);  // publish each prime as soon as it is written
+    }
+    prime_cache_unlock(cache);
+    return ret;
+}
+
 typedef struct prime_sieve prime_sieve;
 typedef struct prime_counter prime_counter;
 struct prime_counter {
@@ -25,6 +210,8 @@ struct prime_counter {
      * @phase: An indicator that flips every time the iterator moves
      * @idx: The current position of the counter
      * @stop: The point where the counter is exhausted
+     * @cache: The prime cache this counter reads from and extends
+     * @last: The prime most recently yielded, used to continue once the cache hits its limit
      *
      * See IteratorHead
      */
@@ -32,13 +219,10 @@ struct prime_counter {
     size_t idx;
     uintmax_t stop;
     prime_sieve *ps;
+    prime_cache *cache;
+    uintmax_t last;
 };
 
-static uintmax_t *prime_cache;
-// note: If you let it, this will grow indefinitely. To not let it do so, #define PRIME_CACHE_SIZE_LIMIT
-static uintmax_t prime_cache_max = 0;
-static size_t prime_cache_size = 0;
-static size_t prime_cache_idx = 0;
 prime_sieve prime_sieve0();
 
 uintmax_t advance_prime_counter(prime_counter *pc) {
@@ -49,77 +233,27 @@ uintmax_t advance_prime_counter(prime_counter *pc) {
      * Returns the next number in the iteration
      */
     IterationHead(pc);
-    if (!prime_cache_size)  {  // if not already done, initialize the prime cache
-        prime_cache = (uintmax_t *) malloc(sizeof(uintmax_t) * 4);
-        prime_cache[0] = 2;
-        prime_cache[1] = 3;
-        prime_cache[2] = 5;
-        prime_cache[3] = prime_cache_max = 7;
-        prime_cache_size = 4;
-        prime_cache_idx = 4;
-    }
-    if (pc->idx < prime_cache_idx)  {
-        uintmax_t p = prime_cache[pc->idx++];
-        if ((pc->exhausted = (p >= pc->stop)))  {
-            return 0;
-        }
-        return p;
+    uintmax_t p;
+    size_t len = prime_cache_load_len(pc->cache);
+    if (pc->idx < len || extend_prime_cache(pc->cache, pc->idx + 1))  {
+        p = *prime_cache_slot(pc->cache, pc->idx);
+    } else  {
+        // the cache is full, so continue past it without storing anything
+        p = next_uncached_prime(pc->cache, prime_cache_load_len(pc->cache), pc->last);
     }
-    for (uintmax_t p = prime_cache[pc->idx - 1] + 2; p < pc->stop; p += 2) {
-        bool broken = false;
-        for (size_t idx = 1; idx < prime_cache_idx; idx++)  {
-            if (p % prime_cache[idx] == 0)  {  // is not prime
-                broken = true;
-                break;
-            }
-        }
-        if (!broken)    {  // primeness not determined, exceeded cache
-            uintmax_t root_p = ceil(sqrt(p));
-            for (uintmax_t c = prime_cache_max; c <= root_p; c += 2)  {
-                if (p % c == 0) {  // is not prime
-                    broken = true;
-                    break;
-                }
-            }
-        }
-        if (!broken)    {  // is prime
-            if (pc->idx == prime_cache_idx) {
-#ifdef PRIME_CACHE_SIZE_LIMIT
-                if (prime_cache_size == prime_cache_idx && prime_cache_size < PRIME_CACHE_SIZE_LIMIT)   {
-#else
-                if (prime_cache_size == prime_cache_idx)    {
-#endif
-                    size_t new_size = prime_cache_size * 2;
-#ifdef PRIME_CACHE_SIZE_LIMIT
-                    if (new_size > PRIME_CACHE_SIZE_LIMIT)  {
-                        new_size = PRIME_CACHE_SIZE_LIMIT;
-                    }
-#endif
-                    void *tmp = realloc(prime_cache, new_size * sizeof(uintmax_t));
-                    if (tmp != NULL)    {
-                        prime_cache = (uintmax_t *) tmp;
-                        prime_cache_size = new_size;
-                        prime_cache[prime_cache_idx++] = prime_cache_max = p;
-                    }
-                } else  {
-                    prime_cache[prime_cache_idx++] = p;
-                }
-            }
-            pc->idx++;
-            if ((pc->exhausted = (p >= pc->stop)))  {
-                return 0;
-            }
-            return p;
-        }
+    pc->idx++;
+    pc->last = p;
+    if ((pc->exhausted = (p >= pc->stop)))  {
+        return 0;
     }
-    pc->exhausted = true;  // shouldn't get here, but just in case
-    return 0;
+    return p;
 }
 
-prime_counter prime_counter1(uintmax_t stop)  {
+prime_counter prime_counter2(uintmax_t stop, prime_cache *cache)  {
     /**
      * The base constructor for the prime number generator
      * @stop: The point where the counter is exhausted
+     * @cache: The prime cache this counter should read from and extend
      *
      * See prime_counter
      */
@@ -128,9 +262,22 @@ prime_counter prime_counter1(uintmax_t stop)  {
     ret.idx = 0;
     ret.stop = stop;
     ret.ps = NULL;
+    ret.cache = cache;
+    ret.last = 0;
     return ret;
 }
 
+prime_counter prime_counter1(uintmax_t stop);
+inline prime_counter prime_counter1(uintmax_t stop)  {
+    /**
+     * The simpler constructor for the prime number generator, which uses global_prime_cache
+     * @stop: The point where the counter is exhausted
+     *
+     * See prime_counter
+     */
+    return prime_counter2(stop, &global_prime_cache);
+}
+
 prime_counter prime_counter0();
 inline prime_counter prime_counter0()   {
     /**
@@ -141,31 +288,109 @@ inline prime_counter prime_counter0()   {
     return prime_counter1(-1);
 }
 
+#ifndef PRIME_SIEVE_SEGMENT_SIZE
+    #define PRIME_SIEVE_SEGMENT_SIZE 32768
+    // the size of one sieve segment in bytes. The default is chosen to fit in a typical L1 data cache
+#endif
+#define PRIME_SIEVE_SEGMENT_WORDS (PRIME_SIEVE_SEGMENT_SIZE / sizeof(uint64_t))
+#define PRIME_SIEVE_SEGMENT_BITS (PRIME_SIEVE_SEGMENT_WORDS * 64)
+#define PRIME_SIEVE_SEGMENT_SPAN ((uintmax_t) PRIME_SIEVE_SEGMENT_BITS * 2)
+
 struct prime_sieve {
     /**
-     * The iterator that implements a modified sieve of eratosthenes
+     * The iterator that implements a segmented, odd-only sieve of eratosthenes
      * @iterator_function: The function to advance the iterator and return the next element
      * @exhausted: An indicator that tells you if the iterator is exhausted
      * @started: An indicator that tells you if the interator has moved at all
      * @phase: An indicator that flips every time the iterator moves
-     * @sieve: The sieve state used to generate new primes
-     * @sieve_len: The length of the sieve state (divided by 2)
-     * @prime: The current reference prime
-     * @prime_squared: The reference prime squared
-     * @candidate: The current candidate prime number
+     * @segment: The bit-packed sieve state, where bit i is set if low + 2i is composite
+     * @low: The odd number represented by the first bit of the current segment
+     * @idx: The bit index of the next candidate in the current segment
+     * @primes: The odd reference primes used to cross off composites
+     * @multiples: The next odd multiple of each reference prime that has not been crossed off
+     * @primes_len: The number of reference primes in use
+     * @primes_size: The number of reference primes there is room for
      * @source: The source of new reference prime numbers
      *
      * See IteratorHead
      */
     IteratorHead(uintmax_t, prime_sieve);
-    uintmax_t *sieve;
-    size_t sieve_len;
-    uintmax_t prime;
-    uintmax_t prime_squared;
-    uintmax_t candidate;
+    uint64_t *segment;
+    uintmax_t low;
+    size_t idx;
+    uintmax_t *primes;
+    uintmax_t *multiples;
+    size_t primes_len;
+    size_t primes_size;
     prime_counter source;
 };
 
+uintmax_t first_odd_multiple(uintmax_t p, uintmax_t low);
+inline uintmax_t first_odd_multiple(uintmax_t p, uintmax_t low)   {
+    /**
+     * Finds the first odd multiple of a reference prime that a sieve segment needs to cross off
+     * @p: The odd reference prime
+     * @low: The odd number at the start of the segment
+     *
+     * Returns the smallest odd multiple of p that is >= max(low, p * p)
+     */
+    uintmax_t ret = p * p;
+    if (ret < low)  {
+        ret = low + p - 1 - (low - 1) % p;  // smallest multiple of p >= low
+        if (!(ret & 1)) {
+            ret += p;
+        }
+    }
+    return ret;
+}
+
+void sieve_segment(uint64_t *segment, size_t words, uintmax_t low, const uintmax_t *primes, uintmax_t *multiples, size_t primes_len)  {
+    /**
+     * Crosses off the odd composites in one segment of the sieve
+     * @segment: The bit-packed segment, where bit i represents low + 2i
+     * @words: The length of the segment in 64-bit words
+     * @low: The odd number represented by the first bit of the segment
+     * @primes: The odd reference primes, in ascending order
+     * @multiples: The next odd multiple of each reference prime, which is updated to point past this segment
+     * @primes_len: The number of reference primes
+     *
+     * Note that bits are set for composites, and that 1 is marked as composite when it appears
+     */
+    uintmax_t high = low + (uintmax_t) words * 128;
+    memset(segment, 0, words * sizeof(uint64_t));
+    if (low == 1)   {
+        segment[0] = 1;
+    }
+    for (size_t i = 0; i < primes_len; i++) {
+        uintmax_t p = primes[i], step = p * 2, m = multiples[i];
+        for (; m < high; m += step) {
+            uintmax_t bit = (m - low) / 2;
+            segment[bit / 64] |= (uint64_t) 1 << (bit % 64);
+        }
+        multiples[i] = m;
+    }
+}
+
+void fill_prime_sieve_segment(prime_sieve *ps)  {
+    /**
+     * Sieves the segment starting at ps->low, pulling in new reference primes as needed
+     * @ps: The sieve you want to fill
+     */
+    uintmax_t high = ps->low + PRIME_SIEVE_SEGMENT_SPAN;
+    while (!ps->primes_len || ps->primes[ps->primes_len - 1] * ps->primes[ps->primes_len - 1] < high) {
+        if (ps->primes_len == ps->primes_size)  {
+            ps->primes_size = ps->primes_size ? ps->primes_size * 2 : 64;
+            ps->primes = (uintmax_t *) realloc(ps->primes, ps->primes_size * sizeof(uintmax_t));
+            ps->multiples = (uintmax_t *) realloc(ps->multiples, ps->primes_size * sizeof(uintmax_t));
+        }
+        uintmax_t p = next(ps->source);
+        ps->primes[ps->primes_len] = p;
+        ps->multiples[ps->primes_len++] = first_odd_multiple(p, ps->low);
+    }
+    sieve_segment(ps->segment, PRIME_SIEVE_SEGMENT_WORDS, ps->low, ps->primes, ps->multiples, ps->primes_len);
+    ps->idx = 0;
+}
+
 uintmax_t advance_prime_sieve(prime_sieve *ps) {
     /**
      * The function to advance a prime sieve iterator
@@ -173,55 +398,27 @@ uintmax_t advance_prime_sieve(prime_sieve *ps) {
      *
      * Returns the next prime number in the iteration
      */
-    // modified sieve of eratosthenes adapted to C from Python p0003
-    if (ps->candidate == 2) {
-        ps->candidate = 3;
+    if (!ps->started)   {
+        IterationHead(ps);
         return 2;
     }
-    // if candidate in sieve
+    IterationHead(ps);
     while (true)    {
-        uintmax_t step;
-        bool candidate_in_sieve = false;
-        size_t candidate_index = -1;
-        for (size_t i = 0; i < ps->sieve_len * 2; i += 2)   {
-            if (ps->sieve[i] == ps->candidate)  {
-                step = ps->sieve[i + 1];
-                candidate_in_sieve = true;
-                candidate_index = i;
-                break;
+        size_t word = ps->idx / 64;
+        if (word < PRIME_SIEVE_SEGMENT_WORDS)   {
+            // mask off the candidates we have already yielded
+            uint64_t candidates = ~ps->segment[word] & (~(uint64_t) 0 << (ps->idx % 64));
+            while (!candidates && ++word < PRIME_SIEVE_SEGMENT_WORDS)   {
+                candidates = ~ps->segment[word];
             }
-        }
-        if (!candidate_in_sieve)    {
-            if (ps->candidate < ps->prime_squared)  {  // prime
-                uintmax_t ret = ps->candidate;
-                ps->candidate += 2;
-                return ret;
-            }
-            // == prime_squared
-            step = ps->prime * 2;
-            ps->prime = next(ps->source);
-            ps->prime_squared = ps->prime * ps->prime;
-        }
-        uintmax_t candidate = ps->candidate;
-        ps->candidate += 2;
-        do {
-            candidate += step;
-            candidate_in_sieve = false;
-            for (size_t i = 0; i < ps->sieve_len * 2; i += 2)   {
-                if (ps->sieve[i] == candidate)  {
-                    candidate_in_sieve = true;
-                    break;
-                }
+            if (candidates) {
+                size_t bit = word * 64 + ctz64(candidates);
+                ps->idx = bit + 1;
+                return ps->low + bit * 2;
             }
-        } while (candidate_in_sieve);
-        if (candidate_index != -1)  {
-            ps->sieve[candidate_index] = candidate;
-        } else  {
-            ps->sieve_len++;
-            ps->sieve = (uintmax_t *) realloc(ps->sieve, ps->sieve_len * 2 * sizeof(uintmax_t));
-            ps->sieve[(ps->sieve_len - 1) * 2] = candidate;
-            ps->sieve[ps->sieve_len * 2 - 1] = step;
         }
+        ps->low += PRIME_SIEVE_SEGMENT_SPAN;
+        fill_prime_sieve_segment(ps);
     }
 }
 
@@ -233,23 +430,22 @@ prime_sieve prime_sieve0()  {
      */
     prime_sieve ret;
     IteratorInitHead(ret, advance_prime_sieve);
-    ret.sieve = NULL;
-    ret.sieve_len = 0;
-    ret.prime = 3;
-    ret.prime_squared = 9;
-    ret.candidate = 2;
+    ret.segment = (uint64_t *) malloc(PRIME_SIEVE_SEGMENT_SIZE);
+    ret.low = 1;
+    ret.primes = ret.multiples = NULL;
+    ret.primes_len = ret.primes_size = 0;
     ret.source = prime_counter0();
-    next(ret.source);
-    next(ret.source);
+    next(ret.source);  // skip 2, since only odd numbers are sieved
+    fill_prime_sieve_segment(&ret);
     return ret;
 }
 
 void free_prime_counter(prime_counter pc);
 void free_prime_sieve(prime_sieve ps)   {
     free_prime_counter(ps.source);
-    if (ps.sieve != NULL)   {
-        free(ps.sieve);
-    }
+    free(ps.segment);
+    free(ps.primes);
+    free(ps.multiples);
 }
 
 void free_prime_counter(prime_counter pc)   {
@@ -259,6 +455,300 @@ void free_prime_counter(prime_counter pc)   {
     }
 }
 
+#define SMALL_PRIMES_LEN 54
+static const unsigned char small_primes[SMALL_PRIMES_LEN] = {
+    2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103,
+    107, 109, 113, 127, 131, 137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223,
+    227, 229, 233, 239, 241, 251
+};
+// every number below MAX_SMALL_PRIME_SQUARED with no factor in small_primes is prime
+#define MAX_SMALL_PRIME_SQUARED (257 * 257)
+// a 64-bit number with no factors in small_primes has fewer than this many prime factors
+#define MAX_LARGE_PRIME_FACTORS 8
+#ifndef PRIME_FACTOR_RHO_BATCH
+    #define PRIME_FACTOR_RHO_BATCH 128
+#endif
+
+typedef struct montgomery_ctx montgomery_ctx;
+struct montgomery_ctx   {
+    /**
+     * The precomputed state for Montgomery arithmetic modulo an odd 64-bit number
+     * @n: The odd modulus
+     * @n_inv: The inverse of n mod 2^64
+     * @one: 2^64 mod n, which is 1 in Montgomery form
+     * @r2: 2^128 mod n, which is used to move numbers into Montgomery form
+     */
+    uint64_t n;
+    uint64_t n_inv;
+    uint64_t one;
+    uint64_t r2;
+};
+
+montgomery_ctx montgomery_ctx1(uint64_t n)  {
+    /**
+     * The constructor for Montgomery arithmetic state
+     * @n: The odd modulus
+     *
+     * See montgomery_ctx
+     */
+    montgomery_ctx ret;
+    ret.n = ret.n_inv = n;  // correct to 3 bits, and each Newton step doubles that
+    for (unsigned char i = 0; i < 5; i++)   {
+        ret.n_inv *= 2 - n * ret.n_inv;
+    }
+    ret.one = ret.r2 = (0 - n) % n;
+    for (unsigned char i = 0; i < 64; i++)  {
+        ret.r2 = (ret.r2 >= n - ret.r2) ? ret.r2 - (n - ret.r2) : ret.r2 * 2;
+    }
+    return ret;
+}
+
+uint64_t montgomery_mul(const montgomery_ctx *ctx, uint64_t a, uint64_t b);
+inline uint64_t montgomery_mul(const montgomery_ctx *ctx, uint64_t a, uint64_t b)  {
+    /**
+     * Multiplies two numbers in Montgomery form
+     * @ctx: The Montgomery state for the modulus
+     * @a: A number in Montgomery form, smaller than ctx->n
+     * @b: A number in Montgomery form, smaller than ctx->n
+     *
+     * Returns a * b in Montgomery form
+     */
+    uint64_t hi, lo = mul_64x64(a, b, &hi), mn_hi;
+    mul_64x64(lo * ctx->n_inv, ctx->n, &mn_hi);  // the low half of this product is lo, so they cancel exactly
+    return (hi < mn_hi) ? hi - mn_hi + ctx->n : hi - mn_hi;
+}
+
+uint64_t to_montgomery(const montgomery_ctx *ctx, uint64_t a);
+inline uint64_t to_montgomery(const montgomery_ctx *ctx, uint64_t a)   {
+    /**
+     * Converts a number into Montgomery form
+     * @ctx: The Montgomery state for the modulus
+     * @a: The number you wish to convert
+     */
+    return montgomery_mul(ctx, a % ctx->n, ctx->r2);
+}
+
+uint64_t montgomery_pow(const montgomery_ctx *ctx, uint64_t a, uint64_t e)  {
+    /**
+     * Raises a number in Montgomery form to a power using exponentiation by squaring
+     * @ctx: The Montgomery state for the modulus
+     * @a: The base, in Montgomery form
+     * @e: The exponent
+     *
+     * Returns a^e in Montgomery form
+     */
+    uint64_t ret = ctx->one;
+    while (e)   {
+        if (e & 1)  {
+            ret = montgomery_mul(ctx, ret, a);
+        }
+        a = montgomery_mul(ctx, a, a);
+        e >>= 1;
+    }
+    return ret;
+}
+
+bool miller_rabin(uint64_t n)   {
+    /**
+     * Deterministically tells you if an odd number is prime
+     * @n: The odd number you wish to test, which must be greater than 2
+     *
+     * This uses a set of seven witnesses that is known to have no strong pseudoprimes below 2^64
+     */
+    static const uint64_t witnesses[7] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+    montgomery_ctx ctx = montgomery_ctx1(n);
+    uint64_t d = n - 1, minus_one = n - ctx.one;  // one is never 0 for n > 1
+    unsigned char s = ctz64(d);
+    d >>= s;
+    for (unsigned char i = 0; i < 7; i++)   {
+        if (!(witnesses[i] % n))    {
+            continue;
+        }
+        uint64_t x = montgomery_pow(&ctx, to_montgomery(&ctx, witnesses[i]), d);
+        if (x == ctx.one || x == minus_one) {
+            continue;
+        }
+        unsigned char j;
+        for (j = 1; j < s; j++) {
+            x = montgomery_mul(&ctx, x, x);
+            if (x == minus_one) {
+                break;
+            }
+        }
+        if (j == s) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t pollard_brent(uint64_t n)  {
+    /**
+     * Finds a non-trivial factor of a composite number using Brent's variant of Pollard's rho algorithm
+     * @n: The odd composite number you wish to split, which must not be a prime power of a small prime
+     *
+     * Returns a factor of n that is neither 1 nor n
+     */
+    montgomery_ctx ctx = montgomery_ctx1(n);
+    for (uint64_t c = ctx.one; ; c = (c + ctx.one) % n) {
+        uint64_t x, y = to_montgomery(&ctx, 2), ys = y, q = ctx.one, g = 1;
+        for (uint64_t r = 1; g == 1; r *= 2)   {
+            x = y;
+            for (uint64_t i = 0; i < r; i++)    {
+                y = montgomery_mul(&ctx, y, y);
+                y = (y >= n - c) ? y - (n - c) : y + c;
+            }
+            for (uint64_t k = 0; k < r && g == 1; k += PRIME_FACTOR_RHO_BATCH) {
+                // multiply differences together so that we only need a gcd() every batch
+                ys = y;
+                for (uint64_t i = 0; i < PRIME_FACTOR_RHO_BATCH && i < r - k; i++)  {
+                    y = montgomery_mul(&ctx, y, y);
+                    y = (y >= n - c) ? y - (n - c) : y + c;
+                    q = montgomery_mul(&ctx, q, (x > y) ? x - y : y - x);
+                }
+                g = gcd(q, n);
+            }
+        }
+        if (g == n) {
+            // the batch overshot, so step back through it one gcd() at a time
+            do  {
+                ys = montgomery_mul(&ctx, ys, ys);
+                ys = (ys >= n - c) ? ys - (n - c) : ys + c;
+                g = gcd((x > ys) ? x - ys : ys - x, n);
+            } while (g == 1);
+        }
+        if (g != n) {
+            return g;
+        }
+    }
+}
+
+unsigned char split_prime_factors(uint64_t n, uint64_t *factors)   {
+    /**
+     * Splits a number with no small prime factors into its prime factors, sorted in ascending order
+     * @n: The number you wish to split, which must have no factors in small_primes
+     * @factors: The output array, which must have room for MAX_LARGE_PRIME_FACTORS numbers
+     *
+     * Returns the number of prime factors written
+     */
+    uint64_t stack[MAX_LARGE_PRIME_FACTORS];
+    unsigned char stack_len = 1, len = 0;
+    stack[0] = n;
+    while (stack_len)   {
+        uint64_t m = stack[--stack_len];
+        if (m < MAX_SMALL_PRIME_SQUARED || miller_rabin(m)) {
+            // insertion sort, since there are at most a handful of these
+            unsigned char i = len++;
+            for (; i && factors[i - 1] > m; i--)    {
+                factors[i] = factors[i - 1];
+            }
+            factors[i] = m;
+        } else  {
+            uint64_t d = pollard_brent(m);
+            stack[stack_len++] = d;
+            stack[stack_len++] = m / d;
+        }
+    }
+    return len;
+}
+
+typedef struct spf_table spf_table;
+struct spf_table    {
+    /**
+     * A table of smallest prime factors, built with a linear sieve
+     * @spf: spf[n] is the smallest prime factor of n, for 2 <= n < len. spf[0] and spf[1] are 0
+     * @phi: phi[n] is Euler's totient of n, or NULL if it was not requested
+     * @mu: mu[n] is the Mobius function of n, or NULL if it was not requested
+     * @primes: The primes below len, in ascending order
+     * @primes_len: The number of entries in primes
+     * @len: The length of each table
+     *
+     * See spf_table3
+     */
+    uint32_t *spf;
+    uint32_t *phi;
+    signed char *mu;
+    uint32_t *primes;
+    size_t primes_len;
+    uint32_t len;
+};
+
+spf_table spf_table3(uint32_t len, bool with_phi, bool with_mu)   {
+    /**
+     * Builds a smallest prime factor table for [0, len), and optionally the totient and Mobius tables
+     * @len: One past the largest number you want to be able to look up
+     * @with_phi: Whether to also fill in phi
+     * @with_mu: Whether to also fill in mu
+     *
+     * Every composite is crossed off exactly once, by its smallest prime factor, so this takes O(len) time. The
+     * multiplicative functions come along for free, since each i * p is either coprime to i or shares p with it.
+     *
+     * See spf_table
+     */
+    spf_table ret;
+    ret.len = len;
+    ret.spf = (uint32_t *) calloc(max(len, 2), sizeof(uint32_t));
+    ret.phi = with_phi ? (uint32_t *) malloc(max(len, 2) * sizeof(uint32_t)) : NULL;
+    ret.mu = with_mu ? (signed char *) malloc(max(len, 2)) : NULL;
+    // past 3, every prime is 1 or 5 mod 6, so there are at most len / 3 + 2 primes below len
+    ret.primes = (uint32_t *) malloc((len / 3 + 2) * sizeof(uint32_t));
+    ret.primes_len = 0;
+    if (ret.phi)    {
+        ret.phi[0] = 0;
+        ret.phi[1] = 1;
+    }
+    if (ret.mu) {
+        ret.mu[0] = 0;
+        ret.mu[1] = 1;
+    }
+    for (uint32_t i = 2; i < len; i++)  {
+        if (!ret.spf[i])    {
+            ret.spf[i] = i;
+            ret.primes[ret.primes_len++] = i;
+            if (ret.phi)    {
+                ret.phi[i] = i - 1;
+            }
+            if (ret.mu) {
+                ret.mu[i] = -1;
+            }
+        }
+        uint32_t bound = (len - 1) / i, smallest = ret.spf[i];
+        for (size_t k = 0; k < ret.primes_len; k++) {
+            uint32_t p = ret.primes[k];
+            if (p > smallest || p > bound)  {
+                break;
+            }
+            ret.spf[i * p] = p;
+            if (ret.phi)    {
+                ret.phi[i * p] = ret.phi[i] * ((p == smallest) ? p : p - 1);
+            }
+            if (ret.mu) {
+                ret.mu[i * p] = (p == smallest) ? 0 : -ret.mu[i];
+            }
+        }
+    }
+    ret.primes = (uint32_t *) realloc(ret.primes, (ret.primes_len + 1) * sizeof(uint32_t));
+    return ret;
+}
+
+spf_table spf_table1(uint32_t len);
+inline spf_table spf_table1(uint32_t len)  {
+    /**
+     * The simpler constructor for the smallest prime factor table, which skips phi and mu
+     * @len: One past the largest number you want to be able to look up
+     *
+     * See spf_table3
+     */
+    return spf_table3(len, false, false);
+}
+
+void free_spf_table(spf_table table)    {
+    free(table.spf);
+    free(table.phi);
+    free(table.mu);
+    free(table.primes);
+}
+
 typedef struct prime_factor_counter prime_factor_counter;
 struct prime_factor_counter {
     /**
@@ -270,6 +760,15 @@ struct prime_factor_counter {
      * @target: The current target for prime factorization (note: this will change after construction)
      * @current: The prime number most recently tested
      * @pc: The prime number generator being used to test
+     * @small_idx: The index of the next entry of small_primes to trial divide by
+     * @large_factors: The sorted prime factors found by split_prime_factors()
+     * @large_len: The number of entries in large_factors
+     * @large_idx: The index of the next entry of large_factors to yield
+     * @spf: A smallest prime factor table to read from instead, or NULL
+     *
+     * Note that numbers are trial divided by small_primes, and anything left over is split by pollard_brent().
+     * pc is only used to trial divide numbers that do not fit in 64 bits. If spf is set, each factor is instead a
+     * single table lookup
      *
      * See IteratorHead
      */
@@ -277,6 +776,11 @@ struct prime_factor_counter {
     uintmax_t target;
     uintmax_t current;
     prime_counter pc;
+    unsigned char small_idx;
+    uint64_t large_factors[MAX_LARGE_PRIME_FACTORS];
+    unsigned char large_len;
+    unsigned char large_idx;
+    const uint32_t *spf;
 };
 
 uintmax_t advance_prime_factor_counter(prime_factor_counter *pfc)  {
@@ -286,7 +790,56 @@ uintmax_t advance_prime_factor_counter(prime_factor_counter *pfc)  {
      *
      * Returns the next number in the iteration
      */
-    while (pfc->target != 0 && pfc->target != 1 && !pfc->pc.exhausted) {
+    IterationHead(pfc);
+    if (pfc->large_idx < pfc->large_len)    {
+        pfc->current = pfc->large_factors[pfc->large_idx++];
+        pfc->exhausted = (pfc->large_idx == pfc->large_len);
+        return pfc->current;
+    }
+    if (pfc->target == 0 || pfc->target == 1)   {
+        pfc->exhausted = true;
+        return -1;
+    }
+    if (pfc->spf)   {
+        pfc->current = pfc->spf[pfc->target];
+        pfc->target /= pfc->current;
+        pfc->exhausted = (pfc->target == 1);
+        return pfc->current;
+    }
+    for (; pfc->small_idx < SMALL_PRIMES_LEN; pfc->small_idx++)  {
+        pfc->current = small_primes[pfc->small_idx];
+        if (pfc->target % pfc->current == 0)    {
+            pfc->target /= pfc->current;
+            pfc->exhausted = (pfc->target == 1);
+            return pfc->current;
+        }
+    }
+    if (pfc->target < MAX_SMALL_PRIME_SQUARED)  {
+        pfc->current = pfc->target;
+        pfc->target = 1;
+        pfc->exhausted = true;
+        return pfc->current;
+    }
+    if (pfc->target <= UINT64_MAX)  {
+        pfc->large_len = split_prime_factors(pfc->target, pfc->large_factors);
+        pfc->target = 1;
+        pfc->current = pfc->large_factors[pfc->large_idx++];
+        pfc->exhausted = (pfc->large_idx == pfc->large_len);
+        return pfc->current;
+    }
+    if (!pfc->pc.started)   {
+        // numbers too wide for pollard_brent() fall back to trial division, starting past small_primes
+        uintmax_t p;
+        while ((p = next(pfc->pc)) <= pfc->current);
+        pfc->current = p;
+    }
+    while (!pfc->pc.exhausted)  {
+        if (pfc->current > pfc->target / pfc->current)  {  // no factors left below the square root
+            pfc->current = pfc->target;
+            pfc->target = 1;
+            pfc->exhausted = true;
+            return pfc->current;
+        }
         if (pfc->target % pfc->current == 0)    {
             pfc->target /= pfc->current;
             pfc->exhausted = (pfc->target == 1);
@@ -312,7 +865,23 @@ prime_factor_counter prime_factors(uintmax_t n)    {
     ret.current = 2;
     ret.target = n;
     ret.pc = prime_counter0();
-    next(ret.pc);
+    ret.small_idx = ret.large_len = ret.large_idx = 0;
+    ret.spf = NULL;
+    return ret;
+}
+
+prime_factor_counter prime_factors_spf(uintmax_t n, const spf_table *table)   {
+    /**
+     * The constructor for a prime factors iterator that reads from a smallest prime factor table
+     * @n: The non-zero number you wish to factor, which must be less than table->len
+     * @table: The table to look factors up in
+     *
+     * Each factor costs one lookup and one division, so this is much faster when factoring many numbers in a range
+     *
+     * See prime_factor_counter, spf_table3
+     */
+    prime_factor_counter ret = prime_factors(n);
+    ret.spf = table->spf;
     return ret;
 }
 
@@ -323,28 +892,56 @@ uintmax_t is_composite(uintmax_t n)   {
      * Tells you if a number is composite, and if so, its smallest prime factor
      * @n: The number you wish to test
      *
+     * Small factors are found by trial division. Past that, numbers that fit in 64 bits are checked with
+     * miller_rabin(), and only composites with no small factors fall back to prime_factor_counter
+     *
      * See prime_factor_counter
      */
     if (!n || n == 1)   {
         return 0;
     }
+    for (unsigned char i = 0; i < SMALL_PRIMES_LEN; i++)  {
+        if (n % small_primes[i] == 0)   {
+            return (n == small_primes[i]) ? 0 : small_primes[i];
+        }
+    }
+    if (n < MAX_SMALL_PRIME_SQUARED || (n <= UINT64_MAX && miller_rabin(n)))   {
+        return 0;
+    }
+    // only composites with no small factors make it here, and factors are yielded in ascending order
     prime_factor_counter iter = prime_factors(n);
     uintmax_t ret = next(iter);
+    free_prime_factor_counter(iter);
     if (ret == n)   {
         return 0;
     }
     return ret;
 }
 
-bool is_prime(uintmax_t n);
-inline bool is_prime(uintmax_t n)  {
+bool is_prime(uintmax_t n)  {
     /**
      * Tells you if a number is prime
      * @n: The number you wish to test
      *
-     * See prime_factor_counter
+     * Unlike is_composite, this never needs to search for a factor of numbers that fit in 64 bits
+     *
+     * See miller_rabin
      */
-    return n && n != 1 && !is_composite(n);
+    if (!n || n == 1)   {
+        return false;
+    }
+    for (unsigned char i = 0; i < SMALL_PRIMES_LEN; i++)  {
+        if (n % small_primes[i] == 0)   {
+            return n == small_primes[i];
+        }
+    }
+    if (n < MAX_SMALL_PRIME_SQUARED)    {
+        return true;
+    }
+    if (n <= UINT64_MAX)    {
+        return miller_rabin(n);
+    }
+    return !is_composite(n);
 }
 
 #endif
@@ -3,6 +3,10 @@ Project Euler Problem 4
 
 This was pretty easy to do, given the digit infrastructure I already had built up
 
+Revision 1:
+
+Palindromes are now checked by reversing the bottom half of each product, so nothing gets allocated per number.
+
 Problem:
 
 A palindromic number reads the same both ways. The largest palindrome made from
@@ -16,24 +20,13 @@ Find the largest palindrome made from the product of two 3-digit numbers.
 
 
 int main(int argc, char const *argv[])  {
-    unsigned int answer = 0, i, j, a, z, prod;
-    bool broken;
-    digit_counter dc;
+    unsigned int answer = 0, i, j, prod;
     for (i = 100; i < 1000; i++)    {
         for (j = 100; j < 1000; j++)    {
             prod = i * j;
-            dc = digits(prod);
-            broken = false;
-            for (a = 0, z = dc.idx; a < z; a++, z--)    {
-                if (dc.digits[a] != dc.digits[z])   {
-                    broken = true;
-                    break;
-                }
-            }
-            if (!broken)    {
+            if (is_palindrome(prod, 10))    {
                 answer = max(answer, prod);
             }
-            free_digit_counter(dc);
         }
     }
     printf("%u", answer);
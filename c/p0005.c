@@ -19,9 +19,10 @@ What is the smallest positive number that is evenly divisible by all of the numb
 int main(int argc, char const *argv[])  {
     unsigned long long answer = 1;
     unsigned char factor_tracker[20] = {0}, local_factor_tracker[20] = {0};
+    spf_table table = spf_table1(21);
     prime_factor_counter pfc;
     for (unsigned char i = 2; i < 21; i++)  {
-        pfc = prime_factors(i);
+        pfc = prime_factors_spf(i, &table);
         while (!pfc.exhausted)  {
             local_factor_tracker[next(pfc)]++;
         }
@@ -31,6 +32,7 @@ int main(int argc, char const *argv[])  {
         }
         free_prime_factor_counter(pfc);
     }
+    free_spf_table(table);
     for (unsigned char i = 2; i < 20; i++)  {
         for (unsigned char j = 0; j < factor_tracker[i]; j++)   {
             answer *= i;
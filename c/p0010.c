@@ -1,7 +1,8 @@
 /*
 Project Euler Problem 10
 
-This is where my prime infrastructure shows its weak points, since the C version doesn't have a sieve.
+This is where my prime infrastructure used to show its weak points, since the C version didn't have a sieve. Now it
+doesn't even need one, since prime_sum() can count up the primes without ever listing them.
 
 Problem:
 
@@ -10,16 +11,11 @@ The sum of the primes below 10 is 2 + 3 + 5 + 7 = 17.
 Find the sum of all the primes below two million.
 */
 #include <stdio.h>
-#include "include/primes.h"
+#include "include/prime_counting.h"
 
 
 int main(int argc, char const *argv[])  {
-    unsigned long long tmp, answer = 0;
-    prime_sieve ps = prime_sieve0();
-    while ((tmp = next(ps)) < 2000000)  {
-        answer += tmp;
-    }
-    free_prime_sieve(ps);
+    unsigned long long answer = (unsigned long long) prime_sum(1999999);
     printf("%llu", answer);  // this is because of a bug
     return 0;
 }
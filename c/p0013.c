@@ -217,16 +217,14 @@ static const char numbers[100][50] = {
 
 
 int main(int argc, char const *argv[])  {
-    BCD_int answer, tmp1, tmp2 = new_BCD_int(0, false);
+    BCD_int answer, tmp, sum = new_BCD_int(0, false);
     for (size_t i = 0; i < 100; i++)    {
-        tmp1 = BCD_from_ascii(numbers[i], 50, false);
-        answer = add_bcd(tmp1, tmp2);
-        free_BCD_int(tmp1);
-        free_BCD_int(tmp2);
-        tmp2 = answer;
+        tmp = BCD_from_ascii(numbers[i], 50, false);
+        add_bcd_into(&sum, tmp);
+        free_BCD_int(tmp);
     }
-    answer = div_bcd_pow_10(tmp2, tmp2.decimal_digits - 10);
-    free_BCD_int(tmp2);
+    answer = div_bcd_pow_10(sum, sum.decimal_digits - 10);
+    free_BCD_int(sum);
     print_bcd(answer);
     free_BCD_int(answer);
     return 0;
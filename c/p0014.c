@@ -3,6 +3,11 @@ Project Euler Problem 14
 
 This was easier to do in C than I would have thought
 
+Revision 1:
+
+The chain lengths now come from a shared 16-bit memo table, filled in bottom up, and the search only looks at the top
+half of the range, since doubling anything below that makes a longer chain.
+
 Problem:
 
 The following iterative sequence is defined for the set of positive integers:
@@ -21,39 +26,13 @@ Which starting number, under one million, produces the longest chain?
 NOTE: Once the chain starts the terms are allowed to go above one million.
 */
 #include <stdio.h>
-#include "include/macros.h"
-
-#define CACHE_SIZE 1000000
-static unsigned int collatz_len_cache[CACHE_SIZE] = {0, 1, 0};
-
-unsigned int collatz_len(unsigned long long n);
-
-inline unsigned int collatz_len(unsigned long long n)    {
-    if (n < CACHE_SIZE && collatz_len_cache[n]) {
-        return collatz_len_cache[n];
-    }
-    unsigned int ret = 0;
-    if (n % 2)  {
-        ret = 2 + collatz_len((3 * n + 1) / 2);
-    } else {
-        ret = 1 + collatz_len(n / 2);
-    }
-    if (n < CACHE_SIZE) {
-        collatz_len_cache[n] = ret;
-    }
-    return ret;
-}
+#include "include/collatz.h"
 
 
 int main(int argc, char const *argv[])  {
-    unsigned long long answer = 2, length = 2, tmp;
-    for (unsigned long long test = 3; test < 1000000; test++)   {
-        tmp = collatz_len(test);
-        if (tmp > length)   {
-            answer = test;
-            length = tmp;
-        }
-    }
-    printf("%llu", answer);
+    collatz_table table = collatz_table1(1000000);
+    collatz_record best = collatz_longest(&table, 1, 1000000, 0);
+    printf("%llu", (unsigned long long) best.start);
+    free_collatz_table(table);
     return 0;
 }
@@ -4,6 +4,10 @@ Project Euler Problem 16
 This was fairly easy to do, given the BCD infrastructure I'd built up already, but I feel like there's a better way
 to do it than this, if I could manage arbitrary-precision multiplication more efficiently.
 
+Revision 1:
+
+The power is now computed on binary limbs, and only converted to decimal once at the end to sum its digits.
+
 Problem:
 
 215 = 32768 and the sum of its digits is 3 + 2 + 7 + 6 + 8 = 26.
@@ -11,16 +15,17 @@ Problem:
 What is the sum of the digits of the number 21000?
 */
 #include <stdio.h>
-#include "include/bcd.h"
+#include "include/bigint.h"
 
 
 int main(int argc, char const *argv[])  {
     unsigned long long answer = 0;
-    BCD_int power = pow_cuint_cuint(256, 125);
-    for (size_t i = 0; i < power.bcd_digits; i++)   {
-        answer += power.digits[i] & 0x0F;
-        answer += power.digits[i] >> 4;
-    }
+    bigint two = new_bigint(2, false), binary_power = pow_bigint(two, 1000);
+    BCD_int power = bcd_from_bigint(binary_power);
+    answer = bcd_digit_sum(power);
     printf("%llu\n", answer);
+    free_bigint(two);
+    free_bigint(binary_power);
+    free_BCD_int(power);
     return 0;
 }
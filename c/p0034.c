@@ -12,21 +12,15 @@ Note: as 1! = 1 and 2! = 2 are not sums they are not included.
 */
 #include <stdio.h>
 #include "include/digits.h"
-#include "include/math.h"
 
 int main(int argc, char const *argv[])  {
-    unsigned long long answer = 0, sum;
-    digit_counter dc;
-    for (unsigned long i = 10; i < 100000; i++) {
-        sum = 0;
-        dc = digits(i);
-        while (!dc.exhausted)   {
-            sum += factorial(next(dc));
-        }
-        if (sum == i)   {
+    unsigned long long answer = 0;
+    digit_odometer od = digit_odometer3(10, 100000, digit_factorials);
+    while (!od.exhausted)   {
+        uintmax_t i = next(od);
+        if (od.table_sum == i)  {
             answer += i;
         }
-        free_digit_counter(dc);
     }
     printf("%llu", answer);
     return 0;
@@ -230,17 +230,18 @@ def test_deterministic_build(c_file, compiler):
 
 
 @mark.skipif('NO_OPTIONAL_TESTS or ONLY_SLOW')
-def test_is_prime(benchmark, compiler):
+@mark.parametrize('MIN_PRIME,MAX_PRIME', [(0, 1_000_000), (1_000_000_000_000, 1_000_000_100_000)])
+def test_is_prime(benchmark, compiler, MIN_PRIME, MAX_PRIME):
     from p0007 import is_prime, prime_factors, primes
-    MAX_PRIME = 1_000_000
-    exename = EXE_TEMPLATE.format("test_is_prime", compiler)
+    exename = EXE_TEMPLATE.format("test_is_prime_{}".format(MIN_PRIME), compiler)
     test_path = C_FOLDER.joinpath("tests", "test_is_prime.c")
-    args = templates[compiler].format(test_path, exename) + " -DMAX_PRIME={}".format(MAX_PRIME)
+    args = templates[compiler].format(test_path, exename)
+    args += " -DMIN_PRIME={} -DMAX_PRIME={}".format(MIN_PRIME, MAX_PRIME)
     check_call(args.split())
     with TemporaryFile('wb+') as f:
         run_test = partial(check_call, [exename], stdout=f)
         benchmark.pedantic(run_test, iterations=1, rounds=1)
-        prime_cache = tuple(primes(MAX_PRIME))
+        prime_cache = tuple(primes(MAX_PRIME)) if not MIN_PRIME else ()
         for line in f.readlines():
             num, prime, composite, idx = (int(x) for x in line.split())
             assert bool(prime) == bool(is_prime(num))
@@ -249,10 +250,38 @@ def test_is_prime(benchmark, compiler):
             assert idx == -1 or prime_cache[idx] == num
 
     # sometimes benchmark disables itself, so check for .stats
-    if hasattr(benchmark, 'stats') and benchmark.stats.stats.max > 200 * MAX_PRIME // 1000000:
+    if hasattr(benchmark, 'stats') and benchmark.stats.stats.max > 200 * (MAX_PRIME - MIN_PRIME) // 1000000:
         fail("Exceeding 200ns average! (time={}s)".format(benchmark.stats.stats.max))
 
 
+@mark.skipif('NO_OPTIONAL_TESTS or ONLY_SLOW')
+def test_parallel_primes(benchmark, compiler):
+    exename = EXE_TEMPLATE.format("test_parallel_primes", compiler)
+    test_path = C_FOLDER.joinpath("tests", "test_parallel_primes.c")
+    check_call(templates[compiler].format(test_path, exename).split())
+    run_test = partial(check_output, [exename])
+    output = benchmark.pedantic(run_test, iterations=1, rounds=1)
+    # each range ends in flags for whether the count, sum, and ordered sieve matched prime_sieve, and each thread
+    # count ends with one for whether freeing an unfinished sieve worked
+    for line in output.decode().splitlines():
+        assert line.endswith(' 1 1 1') or line.endswith(' early stop 1'), line
+
+
+@mark.skipif('NO_OPTIONAL_TESTS or ONLY_SLOW')
+@mark.parametrize('name', [
+    'bcd', 'fibonacci', 'binomial', 'factorial', 'collatz', 'prime_counting', 'factors', 'digits'
+])
+def test_self_checking(benchmark, compiler, name):
+    exename = EXE_TEMPLATE.format("test_" + name, compiler)
+    test_path = C_FOLDER.joinpath("tests", "test_{}.c".format(name))
+    check_call(templates[compiler].format(test_path, exename).split())
+    run_test = partial(check_output, [exename])
+    output = benchmark.pedantic(run_test, iterations=1, rounds=1)
+    # each line ends in a flag for whether that check passed
+    for line in output.decode().splitlines():
+        assert line.endswith(' 1'), line
+
+
 def test_problem(benchmark, key, compiler):
     if (NO_SLOW and key in known_slow) or (ONLY_SLOW and key not in known_slow):
         skip()
@@ -0,0 +1,544 @@
+#include <stdio.h>
+#include "../include/bigint.h"
+
+uint64_t test_state = 0x9E3779B97F4A7C15ULL;
+
+uint64_t test_random()    {
+    // xorshift64, so that every compiler sees the same operands
+    test_state ^= test_state << 13;
+    test_state ^= test_state >> 7;
+    test_state ^= test_state << 17;
+    return test_state;
+}
+
+BCD_int random_bcd(size_t digits, bool negative)    {
+    // returns a random number with exactly this many digits. Every third one is all 9s, to push the carries
+    char *str = (char *) malloc(digits);
+    bool nines = !(test_random() % 3);
+    for (size_t i = 0; i < digits; i++) {
+        str[i] = nines ? '9' : '0' + (char) (test_random() % 10);
+    }
+    if (str[0] == '0')  {
+        str[0] = '1';
+    }
+    BCD_int ret = BCD_from_ascii(str, digits, negative);
+    free(str);
+    return ret;
+}
+
+bool check_divmod_bcd(BCD_int x, BCD_int y)    {
+    // checks that x == q * y + r, that |r| < |y|, and that r takes the sign of x
+    BCD_int q, r, div = div_bcd(x, y), mod = mod_bcd(x, y);
+    divmod_bcd(x, y, &q, &r);
+    BCD_int product = mul_bcd(q, y), total = add_bcd(product, r);
+    bool ret = !cmp_bcd(total, x) && cmp_bcd_magnitude(r, y) < 0 && (r.zero || r.negative == x.negative);
+    ret = ret && !cmp_bcd(div, q) && !cmp_bcd(mod, r);
+    free_BCD_int(q);
+    free_BCD_int(r);
+    free_BCD_int(div);
+    free_BCD_int(mod);
+    free_BCD_int(product);
+    free_BCD_int(total);
+    return ret;
+}
+
+bool test_divmod_bcd()  {
+    // prints x digits, y digits, and whether every sign combination passed, for sizes on both sides of
+    // BCD_NEWTON_THRESHOLD, which only kicks in once both y and x / y are past it
+    const size_t sizes[][2] = {
+        {5, 17}, {20, 3}, {30, 17}, {40, 20}, {500, 250}, {1000, 17},
+        {BCD_NEWTON_THRESHOLD * 2, BCD_NEWTON_THRESHOLD}, {BCD_NEWTON_THRESHOLD * 2 + 5, BCD_NEWTON_THRESHOLD + 3},
+        {BCD_NEWTON_THRESHOLD * 2 + 3, BCD_NEWTON_THRESHOLD + 1}, {BCD_NEWTON_THRESHOLD * 3, BCD_NEWTON_THRESHOLD * 3 - 5},
+        {BCD_NEWTON_THRESHOLD * 5 + 1, BCD_NEWTON_THRESHOLD * 2 + 7}
+    };
+    bool all_ok = true;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)   {
+        bool ok = true;
+        for (unsigned char signs = 0; signs < 4; signs++)   {
+            BCD_int x = random_bcd(sizes[i][0], signs & 1), y = random_bcd(sizes[i][1], signs & 2);
+            ok = ok && check_divmod_bcd(x, y);
+            // an exact multiple, so that the remainder is 0
+            BCD_int multiple = mul_bcd(x, y);
+            ok = ok && check_divmod_bcd(multiple, y) && check_divmod_bcd(multiple, x);
+            free_BCD_int(x);
+            free_BCD_int(y);
+            free_BCD_int(multiple);
+        }
+        printf("divmod %zu %zu %d\n", sizes[i][0], sizes[i][1], ok);
+        all_ok = all_ok && ok;
+    }
+    return all_ok;
+}
+
+bool test_div_bcd_pow_10()  {
+    // prints the shift and whether div_bcd_pow_10() agrees with dividing by a power of 10, for both signs
+    const uintmax_t shifts[] = {1, 2, 3, 7, 8, 33, BCD_NEWTON_THRESHOLD + 1, 2 * BCD_NEWTON_THRESHOLD + 1, 5000};
+    bool all_ok = true;
+    BCD_int one = new_BCD_int(1, false);
+    for (size_t i = 0; i < sizeof(shifts) / sizeof(shifts[0]); i++) {
+        BCD_int power = mul_bcd_pow_10(one, shifts[i]);
+        bool ok = true;
+        for (unsigned char negative = 0; negative < 2; negative++)  {
+            BCD_int x = random_bcd(2 * BCD_NEWTON_THRESHOLD + 7, negative);
+            BCD_int shifted = div_bcd_pow_10(x, shifts[i]), divided = div_bcd(x, power);
+            ok = ok && !cmp_bcd(shifted, divided);
+            free_BCD_int(x);
+            free_BCD_int(shifted);
+            free_BCD_int(divided);
+        }
+        printf("pow_10 %llu %d\n", (unsigned long long) shifts[i], ok);
+        all_ok = all_ok && ok;
+        free_BCD_int(power);
+    }
+    free_BCD_int(one);
+    return all_ok;
+}
+
+bool test_bigint_conversion()   {
+    // prints the size and whether BCD -> bigint -> BCD gets back where it started, and whether multiplying on either
+    // side agrees, for sizes past BIGINT_RADIX_THRESHOLD and BIGINT_KARATSUBA_THRESHOLD limbs (19 digits each)
+    const size_t sizes[] = {1, 19, 20, 39, BIGINT_RADIX_THRESHOLD * 19 + 1, BIGINT_RADIX_BCD_THRESHOLD * 2 + 1,
+                            BIGINT_KARATSUBA_THRESHOLD * 19 * 3, 10007, 40000};
+    bool all_ok = true;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)  {
+        BCD_int x = random_bcd(sizes[i], i & 1), y = random_bcd(sizes[i] / 2 + 1, i & 2);
+        bigint bx = bigint_from_bcd(x), by = bigint_from_bcd(y), bz = mul_bigint(bx, by);
+        BCD_int back = bcd_from_bigint(bx), z = mul_bcd(x, y), bz_bcd = bcd_from_bigint(bz);
+        bool ok = !cmp_bcd(back, x) && !cmp_bcd(z, bz_bcd);
+        printf("convert %zu %d\n", sizes[i], ok);
+        all_ok = all_ok && ok;
+        free_BCD_int(x);
+        free_BCD_int(y);
+        free_BCD_int(back);
+        free_BCD_int(z);
+        free_BCD_int(bz_bcd);
+        free_bigint(bx);
+        free_bigint(by);
+        free_bigint(bz);
+    }
+    return all_ok;
+}
+
+bool test_divmod_bigint()   {
+    // prints x digits, y digits, and whether divmod_bigint() gave x == q * y + r with |r| < |y| and r taking the sign
+    // of x, and matched divmod_bcd(), for every sign combination
+    const size_t sizes[][2] = {{10, 30}, {40, 19}, {60, 40}, {900, 899}, {4000, 1500}, {20000, 700}, {20000, 9000}};
+    bool all_ok = true;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)   {
+        bool ok = true;
+        for (unsigned char signs = 0; signs < 4; signs++)   {
+            BCD_int x = random_bcd(sizes[i][0], signs & 1), y = random_bcd(sizes[i][1], signs & 2), q, r;
+            bigint bx = bigint_from_bcd(x), by = bigint_from_bcd(y), bq, br;
+            divmod_bigint(bx, by, &bq, &br);
+            divmod_bcd(x, y, &q, &r);
+            bigint product = mul_bigint(bq, by), total = add_bigint(product, br);
+            BCD_int q_bcd = bcd_from_bigint(bq), r_bcd = bcd_from_bigint(br);
+            ok = ok && !cmp_bigint(total, bx) && limbs_cmp(br.limbs, br.len, by.limbs, by.len) < 0;
+            ok = ok && (br.zero || br.negative == bx.negative) && !cmp_bcd(q, q_bcd) && !cmp_bcd(r, r_bcd);
+            free_BCD_int(x);
+            free_BCD_int(y);
+            free_BCD_int(q);
+            free_BCD_int(r);
+            free_BCD_int(q_bcd);
+            free_BCD_int(r_bcd);
+            free_bigint(bx);
+            free_bigint(by);
+            free_bigint(bq);
+            free_bigint(br);
+            free_bigint(product);
+            free_bigint(total);
+        }
+        printf("divmod_bigint %zu %zu %d\n", sizes[i][0], sizes[i][1], ok);
+        all_ok = all_ok && ok;
+    }
+    return all_ok;
+}
+
+bigint reduce_bigint(bigint x, bigint m)   {
+    // returns x mod |m| in [0, |m|) the slow way, to check pow_mod_bigint() against
+    bigint r = mod_bigint(x, m), tmp;
+    if (r.negative && !r.zero)  {
+        m.negative = false;
+        tmp = add_bigint(r, m);
+        free_bigint(r);
+        r = tmp;
+    }
+    return r;
+}
+
+bool test_pow_mod()  {
+    // prints x digits, m digits, and whether pow_mod_bigint() and pow_mod_bcd() agree with reducing pow_bigint(), and
+    // with x^(a + b) == x^a * x^b mod m for exponents too large to expand, for every sign combination of x and m
+    const size_t sizes[][2] = {{1, 1}, {5, 3}, {30, 20}, {300, 200}, {700, 1300}, {2000, 1000}};
+    const uintmax_t exponents[] = {0, 1, 2, 7, 64};
+    bool all_ok = true;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)   {
+        bool ok = true;
+        for (unsigned char signs = 0; signs < 4; signs++)   {
+            BCD_int x = random_bcd(sizes[i][0], signs & 1), m = random_bcd(sizes[i][1], signs & 2);
+            bigint bx = bigint_from_bcd(x), bm = bigint_from_bcd(m);
+            for (size_t j = 0; j < sizeof(exponents) / sizeof(exponents[0]); j++)  {
+                bigint by = new_bigint(exponents[j], false), power = pow_bigint(bx, exponents[j]);
+                bigint expected = reduce_bigint(power, bm), got = pow_mod_bigint(bx, by, bm);
+                BCD_int y = new_BCD_int(exponents[j], false), got_bcd = pow_mod_bcd(x, y, m);
+                BCD_int expected_bcd = bcd_from_bigint(expected);
+                ok = ok && !cmp_bigint(got, expected) && !cmp_bcd(got_bcd, expected_bcd);
+                free_bigint(by);
+                free_bigint(power);
+                free_bigint(expected);
+                free_bigint(got);
+                free_BCD_int(y);
+                free_BCD_int(got_bcd);
+                free_BCD_int(expected_bcd);
+            }
+            BCD_int a = random_bcd(sizes[i][1] / 2 + 40, false), b = random_bcd(sizes[i][1] / 3 + 25, false);
+            bigint ba = bigint_from_bcd(a), bb = bigint_from_bcd(b), bab = add_bigint(ba, bb);
+            bigint xa = pow_mod_bigint(bx, ba, bm), xb = pow_mod_bigint(bx, bb, bm), xab = pow_mod_bigint(bx, bab, bm);
+            bigint product = mul_bigint(xa, xb), expected = reduce_bigint(product, bm);
+            ok = ok && !cmp_bigint(xab, expected) && !xab.negative && limbs_cmp(xab.limbs, xab.len, bm.limbs, bm.len) < 0;
+            free_BCD_int(x);
+            free_BCD_int(m);
+            free_BCD_int(a);
+            free_BCD_int(b);
+            free_bigint(bx);
+            free_bigint(bm);
+            free_bigint(ba);
+            free_bigint(bb);
+            free_bigint(bab);
+            free_bigint(xa);
+            free_bigint(xb);
+            free_bigint(xab);
+            free_bigint(product);
+            free_bigint(expected);
+        }
+        printf("pow_mod %zu %zu %d\n", sizes[i][0], sizes[i][1], ok);
+        all_ok = all_ok && ok;
+    }
+    // Fermat's little theorem, with the Mersenne prime 2^127 - 1 as the modulus
+    bigint two = new_bigint(2, false), p = pow_bigint(two, 127), one = new_bigint(1, false), tmp = sub_bigint(p, one);
+    free_bigint(p);
+    p = tmp;
+    tmp = sub_bigint(p, one);
+    bool fermat_ok = true;
+    for (size_t i = 0; i < 4; i++)  {
+        BCD_int x = random_bcd(30 + 20 * i, i & 1);
+        bigint bx = bigint_from_bcd(x), answer = pow_mod_bigint(bx, tmp, p);
+        fermat_ok = fermat_ok && !cmp_bigint(answer, one);
+        free_BCD_int(x);
+        free_bigint(bx);
+        free_bigint(answer);
+    }
+    printf("pow_mod fermat %d\n", fermat_ok);
+    free_bigint(two);
+    free_bigint(p);
+    free_bigint(one);
+    free_bigint(tmp);
+    return all_ok && fermat_ok;
+}
+
+bool test_arena()    {
+    // prints the chunk size, x digits, y digits, and whether add, sub, mul and divmod give the same answers inside a
+    // bcd_arena as they do with the C library, over several rounds of resetting the arena back to a mark
+    const size_t chunk_sizes[] = {0, 256};
+    const size_t sizes[][2] = {{3, 2}, {16, 17}, {40, 20}, {1000, 300}, {BCD_NEWTON_THRESHOLD * 3, BCD_NEWTON_THRESHOLD + 9}};
+    bool all_ok = true;
+    for (size_t c = 0; c < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); c++)  {
+        bcd_arena arena = new_bcd_arena(chunk_sizes[c]);
+        bcd_allocator allocator = bcd_arena_allocator(&arena);
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)  {
+            BCD_int x = random_bcd(sizes[i][0], i & 1), y = random_bcd(sizes[i][1], i & 2), q, r;
+            divmod_bcd(x, y, &q, &r);
+            BCD_int expected[] = {add_bcd(x, y), sub_bcd(x, y), mul_bcd(x, y), q, r};
+            bool ok = true;
+            set_bcd_allocator(&allocator);
+            bcd_arena_marker mark = bcd_arena_mark(&arena);
+            for (unsigned char round = 0; round < 3; round++)  {
+                divmod_bcd(x, y, &q, &r);
+                BCD_int got[] = {add_bcd(x, y), sub_bcd(x, y), mul_bcd(x, y), q, r};
+                for (size_t j = 0; j < sizeof(got) / sizeof(got[0]); j++)  {
+                    ok = ok && !cmp_bcd(got[j], expected[j]);
+                    // the even rounds hand their blocks back to the free lists before resetting
+                    if (!(round & 1))   {
+                        free_BCD_int(got[j]);
+                    }
+                }
+                bcd_arena_reset(&arena, mark);
+            }
+            set_bcd_allocator(NULL);
+            printf("arena %zu %zu %zu %d\n", chunk_sizes[c], sizes[i][0], sizes[i][1], ok);
+            all_ok = all_ok && ok;
+            free_BCD_int(x);
+            free_BCD_int(y);
+            for (size_t j = 0; j < sizeof(expected) / sizeof(expected[0]); j++)  {
+                free_BCD_int(expected[j]);
+            }
+        }
+        free_bcd_arena(&arena);
+    }
+    return all_ok;
+}
+
+void random_digits(char *str, size_t digits) {
+    // fills str with digits random ASCII digits, the first of which isn't 0, and a NUL
+    for (size_t i = 0; i < digits; i++) {
+        str[i] = '0' + (char) (test_random() % 10);
+    }
+    if (digits && str[0] == '0') {
+        str[0] = '1';
+    }
+    str[digits] = 0;
+}
+
+bool check_digit_kernels(const char *str, size_t digits, bool negative)  {
+    // checks reverse_bcd(), is_bcd_palindrome() and bcd_digit_histogram() on str against doing the same to the string
+    BCD_int x = BCD_from_ascii(str, digits, negative), reversed = reverse_bcd(x);
+    char *mirror = (char *) malloc(digits + 1);
+    uintmax_t counts[10], expected[10] = {0};
+    bool palindrome = true;
+    for (size_t i = 0; i < digits; i++) {
+        mirror[i] = str[digits - 1 - i];
+        palindrome = palindrome && mirror[i] == str[i];
+        expected[str[i] - '0']++;
+    }
+    // leading zeros of the mirror are the trailing zeros of x, which BCD_from_ascii() skips
+    BCD_int expected_reversal = BCD_from_ascii(mirror, digits, negative);
+    bcd_digit_histogram(x, counts);
+    bool ok = !cmp_bcd(reversed, expected_reversal) && is_bcd_palindrome(x) == palindrome;
+    ok = ok && !memcmp(counts, expected, sizeof(counts));
+    free_BCD_int(x);
+    free_BCD_int(reversed);
+    free_BCD_int(expected_reversal);
+    free(mirror);
+    return ok;
+}
+
+bool test_digit_kernels()   {
+    // prints the length in bytes and whether reverse_bcd(), is_bcd_palindrome() and bcd_digit_histogram() matched a
+    // string reference for odd and even digit counts, both signs, trailing zeros, palindromes, and near misses. The
+    // lengths straddle the 16 and 32 byte vector steps, and the biggest run past a histogram flush
+    const size_t lengths[] = {1, 2, 15, 16, 17, 31, 32, 33, 64, 65, 127 * 32 + 1, 127 * 16 * 3 + 7, 5000};
+    bool all_ok = true;
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)  {
+        bool ok = true;
+        char *str = (char *) malloc(2 * lengths[i] + 1);
+        for (size_t digits = 2 * lengths[i] - 1; digits <= 2 * lengths[i]; digits++)    {
+            for (unsigned char negative = 0; negative < 2; negative++)  {
+                random_digits(str, digits);
+                ok = ok && check_digit_kernels(str, digits, negative);
+                // trailing zeros, which the reversal drops
+                memset(str + digits - digits / 3, '0', digits / 3);
+                ok = ok && check_digit_kernels(str, digits, negative);
+                // a palindrome, then the same with one digit changed, somewhere other than the middle
+                for (size_t j = 0; j < digits / 2; j++) {
+                    str[digits - 1 - j] = str[j];
+                }
+                ok = ok && check_digit_kernels(str, digits, negative);
+                if (digits > 1) {
+                    size_t j = test_random() % (digits / 2);
+                    str[j] = (str[j] == '9') ? '8' : str[j] + 1;
+                    ok = ok && check_digit_kernels(str, digits, negative);
+                }
+            }
+        }
+        printf("digit kernels %zu %d\n", lengths[i], ok);
+        all_ok = all_ok && ok;
+        free(str);
+    }
+    // a zero that got there in place still owns its heap buffer, which reverse_bcd() mustn't share
+    BCD_int x = random_bcd(30, false), copy = copy_BCD_int(x), reversed;
+    uintmax_t counts[10];
+    sub_bcd_into(&x, copy);
+    reversed = reverse_bcd(x);
+    bcd_digit_histogram(x, counts);
+    bool zero_ok = x.zero && reversed.zero && is_bcd_palindrome(x) && counts[0] == 1;
+    for (unsigned char d = 1; d < 10; d++)  {
+        zero_ok = zero_ok && !counts[d];
+    }
+    free_BCD_int(x);
+    free_BCD_int(copy);
+    free_BCD_int(reversed);
+    printf("digit kernels zero %d\n", zero_ok);
+    return all_ok && zero_ok;
+}
+
+void random_bcd_bytes(packed_BCD_pair *out, size_t n)    {
+    // fills out with n packed bytes in runs of random digits, all 9s, and all 0s, so carries and borrows ripple far
+    for (size_t i = 0; i < n; )  {
+        size_t run = 1 + test_random() % 100;
+        run = min(run, n - i);
+        unsigned char kind = test_random() % 3;
+        for (; run; run--, i++) {
+            out[i] = (kind == 1) ? 0x99 : (kind == 2) ? 0 : (test_random() % 10) << 4 | (test_random() % 10);
+        }
+    }
+}
+
+typedef bool (*bcd_bytes_kernel)(packed_BCD_pair *, const packed_BCD_pair *, const packed_BCD_pair *, size_t, bool);
+
+bool test_add_sub_kernels() {
+    // prints the length in bytes, and whether the SSE2 and AVX2 paths of add_bcd_bytes() and sub_bcd_bytes() give the
+    // same bytes and carry as the scalar loop, for both carries in, both operand orders, and in place
+    const size_t lengths[] = {16, 17, 31, 32, 33, 47, 63, 64, 65, 100, 511, 1024, 4095, 4096};
+    const bcd_bytes_kernel scalar[] = {add_bcd_bytes_scalar, sub_bcd_bytes_scalar};
+    const bcd_bytes_kernel dispatch[] = {add_bcd_bytes, sub_bcd_bytes};
+#if HAS_X64_SIMD
+    const bcd_bytes_kernel sse2[] = {add_bcd_bytes_sse2, sub_bcd_bytes_sse2};
+    const bcd_bytes_kernel avx2[] = {add_bcd_bytes_avx2, sub_bcd_bytes_avx2};
+#endif
+    bool all_ok = true;
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)  {
+        size_t n = lengths[i];
+        packed_BCD_pair *x = (packed_BCD_pair *) malloc(n), *y = (packed_BCD_pair *) malloc(n);
+        packed_BCD_pair *expected = (packed_BCD_pair *) malloc(n), *got = (packed_BCD_pair *) malloc(n);
+        bool ok = true;
+        for (size_t round = 0; round < 40; round++) {
+            random_bcd_bytes(x, n);
+            random_bcd_bytes(y, n);
+            for (unsigned char op = 0; op < 2; op++)    {
+                for (unsigned char carry = 0; carry < 2; carry++)   {
+                    bool expected_carry = scalar[op](expected, x, y, n, carry);
+                    ok = ok && dispatch[op](got, x, y, n, carry) == expected_carry && !memcmp(got, expected, n);
+#if HAS_X64_SIMD
+                    // SSE2 alone over the whole multiple of 16, then the scalar tail
+                    size_t len = n & ~(size_t) 15;
+                    bool c = sse2[op](got, x, y, len, carry);
+                    c = scalar[op](got + len, x + len, y + len, n - len, c);
+                    ok = ok && c == expected_carry && !memcmp(got, expected, n);
+                    if (bcd_has_avx2()) {
+                        len = n & ~(size_t) 31;
+                        c = avx2[op](got, x, y, len, carry);
+                        c = scalar[op](got + len, x + len, y + len, n - len, c);
+                        ok = ok && c == expected_carry && !memcmp(got, expected, n);
+                    }
+#endif
+                    // in place, the way add_bcd_into() and sub_bcd_into() call it
+                    memcpy(got, x, n);
+                    ok = ok && dispatch[op](got, got, y, n, carry) == expected_carry && !memcmp(got, expected, n);
+                }
+            }
+            packed_BCD_pair *tmp = x;
+            x = y;
+            y = tmp;
+        }
+        printf("add_sub kernels %zu %d\n", n, ok);
+        all_ok = all_ok && ok;
+        free(x);
+        free(y);
+        free(expected);
+        free(got);
+    }
+    return all_ok;
+}
+
+bool check_ascii(const char *str, size_t digits, bool negative)  {
+    // checks BCD_from_ascii() on str against packing it a byte at a time, and bcd_to_chars() against str itself with
+    // its leading zeros taken off and the sign put on
+    packed_BCD_pair *bytes = (packed_BCD_pair *) malloc(digits / 2 + 1);
+    char *expected = (char *) malloc(digits + 2), *got = (char *) malloc(digits + 2);
+    size_t len = 0, skip = 0;
+    for (; skip + 1 < digits && str[skip] == '0'; skip++);
+    for (; 2 * len < digits - skip; len++)  {
+        size_t low = digits - 1 - 2 * len;
+        bytes[len] = (str[low] - '0') | ((low > skip) ? (str[low - 1] - '0') << 4 : 0);
+    }
+    bool zero = (str[skip] == '0');
+    snprintf(expected, digits + 2, "%s%s", (negative && !zero) ? "-" : "", str + skip);
+    BCD_int x = BCD_from_ascii(str, digits, negative), reference = BCD_from_bytes(bytes, len, negative, true);
+    bool ok = !cmp_bcd(x, reference) && x.zero == zero && (zero || x.decimal_digits == digits - skip);
+    ok = ok && bcd_to_chars(x, got) == strlen(expected) && !strcmp(got, expected);
+    free_BCD_int(x);
+    free_BCD_int(reference);
+    free(bytes);
+    free(expected);
+    free(got);
+    return ok;
+}
+
+#if HAS_INT128
+bool check_uint128(unsigned __int128 a, bool negative)    {
+    // checks BCD_from_uint128() against writing a out one digit at a time, and against BCD_from_ascii() on the result
+    char expected[42], got[42];
+    size_t i = sizeof(expected) - 1;
+    bool zero = !a;
+    BCD_int x = BCD_from_uint128(a, negative);
+    expected[i] = 0;
+    do  {
+        expected[--i] = '0' + (char) (a % 10);
+        a /= 10;
+    } while (a);
+    BCD_int parsed = BCD_from_ascii(expected + i, sizeof(expected) - 1 - i, negative);
+    if (negative && !zero)  {
+        expected[--i] = '-';
+    }
+    bool ok = bcd_to_chars(x, got) == sizeof(expected) - 1 - i && !strcmp(got, expected + i) && !cmp_bcd(x, parsed);
+    free_BCD_int(x);
+    free_BCD_int(parsed);
+    return ok;
+}
+#endif
+
+bool test_ascii_round_trip()    {
+    // prints whether digits survived going from ASCII to BCD_int and back for lengths either side of the 16 character
+    // packing step and the 8 byte unpacking step, odd and even, with and without leading zeros, and both signs, then
+    // whether BCD_from_uint128() got 0, 2^64 - 1, 2^64, 10^18 and 10^36 and their neighbours, 2^128 - 1, and
+    // random values right
+    const size_t lengths[] = {1, 2, 3, 15, 16, 17, 18, 31, 32, 33, 47, 48, 49, 64, 65, 100, 1001};
+    const size_t padding[] = {0, 1, 2, 15, 16, 17};
+    bool ascii_ok = true, uint128_ok = true;
+    char *str = (char *) malloc(1001 + 17 + 1);
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)  {
+        for (size_t j = 0; j < sizeof(padding) / sizeof(padding[0]); j++)  {
+            for (unsigned char negative = 0; negative < 2; negative++)  {
+                memset(str, '0', padding[j]);
+                random_digits(str + padding[j], lengths[i]);
+                ascii_ok = ascii_ok && check_ascii(str, padding[j] + lengths[i], negative);
+                // all 9s, and then all 0s, which has to come back as a lone unsigned 0
+                memset(str + padding[j], '9', lengths[i]);
+                ascii_ok = ascii_ok && check_ascii(str, padding[j] + lengths[i], negative);
+                memset(str, '0', padding[j] + lengths[i]);
+                ascii_ok = ascii_ok && check_ascii(str, padding[j] + lengths[i], negative);
+            }
+        }
+    }
+    free(str);
+    printf("ascii round trip %d\n", ascii_ok);
+#if HAS_INT128
+    const unsigned __int128 two_64 = (unsigned __int128) 1 << 64, ten_18 = 1000000000000000000ULL;
+    const unsigned __int128 edges[] = {0, two_64 - 1, two_64, ten_18, ten_18 * ten_18, ~(unsigned __int128) 0};
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++)  {
+        for (unsigned char negative = 0; negative < 2; negative++)  {
+            uint128_ok = uint128_ok && check_uint128(edges[i], negative);
+            uint128_ok = uint128_ok && check_uint128(edges[i] - 1, negative) && check_uint128(edges[i] + 1, negative);
+        }
+    }
+    // and the strings themselves, so that the reference doesn't have to be trusted
+    const char *known[] = {"18446744073709551615", "18446744073709551616", "340282366920938463463374607431768211455"};
+    const unsigned __int128 known_values[] = {two_64 - 1, two_64, ~(unsigned __int128) 0};
+    char buf[42];
+    for (size_t i = 0; i < sizeof(known) / sizeof(known[0]); i++)  {
+        BCD_int x = BCD_from_uint128(known_values[i], false);
+        uint128_ok = uint128_ok && bcd_to_chars(x, buf) == strlen(known[i]) && !strcmp(buf, known[i]);
+        free_BCD_int(x);
+    }
+    for (size_t i = 0; i < 10000; i++)  {
+        unsigned __int128 a = ((unsigned __int128) test_random() << 64) | test_random();
+        uint128_ok = uint128_ok && check_uint128(a >> (i % 128), i & 1);
+    }
+    printf("uint128 %d\n", uint128_ok);
+#endif
+    return ascii_ok && uint128_ok;
+}
+
+int main(int argc, char const *argv[]) {
+    // each line ends in 1 if that check passed, or 0 if it failed
+    bool ok = test_divmod_bcd();
+    ok = test_div_bcd_pow_10() && ok;
+    ok = test_bigint_conversion() && ok;
+    ok = test_divmod_bigint() && ok;
+    ok = test_pow_mod() && ok;
+    ok = test_arena() && ok;
+    ok = test_digit_kernels() && ok;
+    ok = test_add_sub_kernels() && ok;
+    ok = test_ascii_round_trip() && ok;
+    return !ok;
+}
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include "../include/binomial.h"
+
+#define PASCAL_ROWS 600
+#define EXACT_ROWS 140
+
+const char *C100_50 = "100891344545564193334812497256";
+
+bool test_binomial_mod()    {
+    // prints p, k, and whether binomial_mod() agrees with a Pascal's triangle mod p^k for every C(n, r) with n below
+    // PASCAL_ROWS, and with binomial_bigint() reduced mod p^k for a spread of much larger n
+    const uint64_t cases[][2] = {
+        {2, 1}, {2, 3}, {2, 5}, {3, 1}, {3, 3}, {5, 2}, {5, 3}, {7, 2}, {11, 2}, {13, 1}, {997, 1}, {1009, 1}, {31, 3}
+    };
+    bool all_ok = true;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)  {
+        binomial_mod_table table = binomial_mod_table2(cases[i][0], (unsigned char) cases[i][1]);
+        pascal_table pascal = pascal_table1(table.modulus);
+        bool ok = true;
+        for (uintmax_t n = 0; n < PASCAL_ROWS; n++) {
+            for (uintmax_t r = 0; r <= n + 1; r++)  {
+                ok = ok && binomial_mod(&table, n, r) == pascal_choose(&pascal, n, r);
+            }
+        }
+        bigint m = new_bigint(table.modulus, false);
+        for (uintmax_t n = 1000; n < 6000; n += 1237)   {
+            for (uintmax_t r = 0; r <= n; r += n / 7 + 3)   {
+                bigint exact = binomial_bigint(n, r), reduced = mod_bigint(exact, m);
+                uint64_t expected = reduced.zero ? 0 : reduced.limbs[0];
+                ok = ok && binomial_mod(&table, n, r) == expected;
+                free_bigint(exact);
+                free_bigint(reduced);
+            }
+        }
+        printf("binomial_mod %llu %llu %d\n", (unsigned long long) cases[i][0], (unsigned long long) cases[i][1], ok);
+        all_ok = all_ok && ok;
+        free_bigint(m);
+        free_pascal_table(pascal);
+        free_binomial_mod_table(table);
+    }
+    return all_ok;
+}
+
+bool test_binomial_exact()  {
+    // prints whether binomial_bigint() gives the known C(100, 50), then walks Pascal's triangle in bigints up to
+    // EXACT_ROWS and prints whether binomial_bigint() (on a spread of rows, since each call sieves), the exact
+    // pascal_table wherever it doesn't overflow, and binomial_u128() agree with it
+    BCD_int expected = BCD_from_ascii(C100_50, strlen(C100_50), false), got;
+    bigint exact = binomial_bigint(100, 50);
+    got = bcd_from_bigint(exact);
+    bool known_ok = !cmp_bcd(got, expected);
+    free_BCD_int(expected);
+    free_BCD_int(got);
+    free_bigint(exact);
+    printf("binomial_bigint 100 50 %d\n", known_ok);
+
+    bool bigint_ok = true, pascal_ok = true, u128_ok = true;
+    bigint row[EXACT_ROWS + 1], tmp;
+    pascal_table pascal = pascal_table1(0);
+    for (uintmax_t n = 0; n < EXACT_ROWS; n++) {
+        // C(n, r) = C(n - 1, r - 1) + C(n - 1, r), updated in place from the right
+        row[n] = new_bigint(1, false);
+        for (uintmax_t r = n - 1; r && r != (uintmax_t) -1; r--)    {
+            tmp = add_bigint(row[r], row[r - 1]);
+            free_bigint(row[r]);
+            row[r] = tmp;
+        }
+        for (uintmax_t r = 0; r <= n; r++)  {
+            if (n % 11 == 0)    {
+                exact = binomial_bigint(n, r);
+                bigint_ok = bigint_ok && !cmp_bigint(exact, row[r]);
+                free_bigint(exact);
+            }
+            uintmax_t value = pascal_choose(&pascal, n, r);
+            pascal_ok = pascal_ok && (value == UINTMAX_MAX || (row[r].len == 1 && row[r].limbs[0] == value));
+#if HAS_INT128
+            unsigned __int128 expected = -1;
+            if (row[r].len <= 2)    {
+                expected = row[r].limbs[0] | ((row[r].len == 2) ? (unsigned __int128) row[r].limbs[1] << 64 : 0);
+            }
+            u128_ok = u128_ok && binomial_u128(n, r) == expected;
+#endif
+        }
+        pascal_ok = pascal_ok && !pascal_choose(&pascal, n, n + 1);
+        exact = binomial_bigint(n, n + 1);
+        bigint_ok = bigint_ok && exact.zero;
+        free_bigint(exact);
+#if HAS_INT128
+        u128_ok = u128_ok && !binomial_u128(n, n + 1);
+#endif
+    }
+    for (uintmax_t r = 0; r < EXACT_ROWS; r++)  {
+        free_bigint(row[r]);
+    }
+    free_pascal_table(pascal);
+#if HAS_INT128
+    // C(2^32, 3) is past 2^64 but nowhere near 2^128, and C(2^40, 4) is around 2^155
+    u128_ok = u128_ok && binomial_u128((uintmax_t) 1 << 32, 3) == (((unsigned __int128) 1 << 32)
+                            * (((uintmax_t) 1 << 32) - 1) * (((uintmax_t) 1 << 32) - 2) / 6);
+    u128_ok = u128_ok && binomial_u128((uintmax_t) 1 << 40, 4) == (unsigned __int128) -1;
+#endif
+    printf("binomial_bigint rows %d\n", bigint_ok);
+    printf("pascal_table exact %d\n", pascal_ok);
+    printf("binomial_u128 %d\n", u128_ok);
+    return known_ok && bigint_ok && pascal_ok && u128_ok;
+}
+
+int main(int argc, char const *argv[]) {
+    // each line ends in 1 if that check passed, or 0 if it failed
+    bool ok = test_binomial_mod();
+    ok = test_binomial_exact() && ok;
+    return !ok;
+}
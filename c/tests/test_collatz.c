@@ -0,0 +1,124 @@
+#include <stdio.h>
+#define COLLATZ_SEARCH_LANES 1  // so that collatz_longest() goes through collatz_length_x4() as well
+#include "../include/collatz.h"
+
+uint64_t test_state = 0x9E3779B97F4A7C15ULL;
+
+uint64_t test_random()    {
+    // xorshift64, so that every compiler sees the same starting values
+    test_state ^= test_state << 13;
+    test_state ^= test_state >> 7;
+    test_state ^= test_state << 17;
+    return test_state;
+}
+
+uint32_t naive_length(uint64_t n, uint64_t limit, bool *crossed)   {
+    // counts the terms of the chain from n one step at a time, the same way collatz_length() does, and notes whether
+    // it climbs from below limit to past it. Returns 0 where collatz_length() would
+    if (!n) {
+        return 0;
+    }
+#if HAS_INT128
+    unsigned __int128 x = n;
+#else
+    uint64_t x = n;
+#endif
+    uint32_t ret = 1;
+    for (; x != 1; ret++)   {
+        if (x & 1)  {
+#if !HAS_INT128
+            if (x > (UINT64_MAX - 1) / 3)   {
+                return 0;
+            }
+#endif
+            x = 3 * x + 1;
+        } else  {
+            x >>= 1;
+        }
+        *crossed = *crossed || (n < limit && x >= limit);
+    }
+    return ret;
+}
+
+bool check_batch(const collatz_table *table, const uint64_t *starts, size_t *crossings)  {
+    // checks collatz_length_x4() and collatz_length() against naive_length() for 4 starting values
+    uint32_t lengths[4];
+    bool ok = true;
+    collatz_length_x4(table, starts, lengths);
+    for (unsigned char i = 0; i < 4; i++)   {
+        bool crossed = false;
+        uint32_t expected = naive_length(starts[i], table->jump_limit, &crossed);
+        *crossings += crossed;
+        ok = ok && lengths[i] == expected && collatz_length(table, starts[i]) == expected;
+    }
+    return ok;
+}
+
+bool test_collatz_lanes()  {
+    // prints the table size, the jump size, how many chains crossed jump_limit, and whether collatz_length_x4() and
+    // collatz_length() agreed with stepping one term at a time. Batches mix small starts with ones just under
+    // jump_limit, whose chains climb past it partway through, and ones that start past it
+    const uint64_t sizes[][2] = {{1 << 20, 16}, {1000, 18}, {1, 3}, {5000, 1}, {10, 0}, {0, COLLATZ_JUMP_BITS}};
+    bool all_ok = true;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)  {
+        collatz_table table = collatz_table2(sizes[i][0], (unsigned char) sizes[i][1]);
+        uint64_t starts[4], limit = table.jump_limit;
+        size_t crossings = 0;
+        bool ok = true;
+        for (uint64_t n = 0; n < 100000; n += 4)    {
+            starts[0] = n;
+            starts[1] = n + 1;
+            starts[2] = limit - 1 - n;
+            starts[3] = limit + n;
+            ok = ok && check_batch(&table, starts, &crossings);
+        }
+        for (size_t j = 0; j < 20000; j++)  {
+            // 50-bit starts, a few near UINT64_MAX, and a mix of both sides of jump_limit
+            starts[0] = (test_random() >> 14) | ((uint64_t) 1 << 49);
+            starts[1] = UINT64_MAX - (test_random() & 0xFFFF);
+            starts[2] = limit - 1 - (test_random() & 0xFFFFFFF);
+            starts[3] = test_random() % table.len;
+            ok = ok && check_batch(&table, starts, &crossings);
+        }
+        ok = ok && crossings;
+        printf("x4 %llu %llu %llu %d\n", (unsigned long long) table.len, (unsigned long long) table.jump_bits,
+               (unsigned long long) crossings, ok);
+        all_ok = all_ok && ok;
+        free_collatz_table(table);
+    }
+    return all_ok;
+}
+
+bool test_collatz_longest()  {
+    // prints the range, the thread count, and whether collatz_longest() finds the known 837799 (525 terms) below a
+    // million, and agrees with a scalar search over a range whose bottom half isn't memoized
+    collatz_table table = collatz_table1(1 << 16);
+    const unsigned thread_counts[] = {1, 3, 0};
+    bool all_ok = true;
+    collatz_record expected = {0, 0};
+    uint64_t lo = 50000000, hi = 50300000;
+    for (uint64_t n = lo; n < hi; n++)  {
+        uint32_t length = collatz_length(&table, n);
+        if (length > expected.length)   {
+            expected.start = n;
+            expected.length = length;
+        }
+    }
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++)  {
+        collatz_record known = collatz_longest(&table, 1, 1000000, thread_counts[t]);
+        collatz_record got = collatz_longest(&table, lo, hi, thread_counts[t]);
+        bool ok = known.start == 837799 && known.length == 525;
+        ok = ok && got.start == expected.start && got.length == expected.length;
+        printf("longest %u %d\n", thread_counts[t], ok);
+        all_ok = all_ok && ok;
+    }
+    free_collatz_table(table);
+    return all_ok;
+}
+
+int main(int argc, char const *argv[]) {
+    // each line ends in 1 if that check passed, or 0 if it failed
+    bool ok = test_collatz_lanes();
+    ok = test_collatz_longest() && ok;
+    return !ok;
+}
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include "../include/digits.h"
+
+uint64_t test_state = 0x9E3779B97F4A7C15ULL;
+
+uint64_t test_random()    {
+    // xorshift64, so that every compiler sees the same numbers
+    test_state ^= test_state << 13;
+    test_state ^= test_state >> 7;
+    test_state ^= test_state << 17;
+    return test_state;
+}
+
+bool reference_palindrome(uintmax_t n, unsigned int base)  {
+    // writes n out in base, then compares it against itself back to front
+    unsigned char written[64];
+    size_t len = 0;
+    do  {
+        written[len++] = n % base;
+        n /= base;
+    } while (n);
+    for (size_t i = 0; i < len / 2; i++)    {
+        if (written[i] != written[len - 1 - i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uintmax_t mirror(uintmax_t n, unsigned int base, bool odd)   {
+    // builds a palindrome in base by reflecting n, sharing its last digit if odd is set
+    uintmax_t ret = n;
+    for (n = odd ? n / base : n; n; n /= base)  {
+        ret = ret * base + n % base;
+    }
+    return ret;
+}
+
+bool check_digits(uintmax_t n)  {
+    // checks digits2() both ways round, digit_sum(), digit_factorial_sum(), and is_palindrome() against printf
+    char str[MAX_DIGITS_64 + 1];
+    size_t len = (size_t) snprintf(str, sizeof(str), "%ju", n);
+    uintmax_t sum = 0, factorial_sum = 0;
+    bool ok = true;
+    digit_counter forward = digits2(n, false), backward = digits2(n, true);
+    for (size_t i = 0; i < len; i++)    {
+        ok = ok && !forward.exhausted && next(forward) == str[i] - '0';
+        ok = ok && !backward.exhausted && next(backward) == str[len - 1 - i] - '0';
+        sum += str[i] - '0';
+        factorial_sum += digit_factorials[str[i] - '0'];
+    }
+    ok = ok && forward.exhausted && backward.exhausted;
+    free_digit_counter(forward);
+    free_digit_counter(backward);
+    ok = ok && digit_sum(n) == sum && digit_factorial_sum(n) == factorial_sum;
+    const unsigned int bases[] = {2, 3, 10, 16};
+    for (size_t i = 0; i < sizeof(bases) / sizeof(bases[0]); i++)  {
+        ok = ok && is_palindrome(n, bases[i]) == reference_palindrome(n, bases[i]);
+    }
+    return ok;
+}
+
+bool test_digits()  {
+    // prints whether the digit helpers agreed with printf for every n below a million, the powers of 10 and their
+    // neighbours, UINTMAX_MAX, random 64-bit numbers, and palindromes in bases 2, 10 and 16 built by reflection
+    bool small_ok = true, edges_ok = true, random_ok = true, palindromes_ok = true;
+    for (uintmax_t n = 0; n < 1000000; n++) {
+        small_ok = small_ok && check_digits(n);
+    }
+    for (uintmax_t power = 1; power <= UINTMAX_MAX / 10; power *= 10)    {
+        for (uintmax_t n = power * 10 - 2; n <= power * 10 + 2; n++) {
+            edges_ok = edges_ok && check_digits(n);
+        }
+    }
+    for (uintmax_t n = UINTMAX_MAX - 1000; n; n++)  {
+        edges_ok = edges_ok && check_digits(n);
+    }
+    for (size_t i = 0; i < 100000; i++) {
+        random_ok = random_ok && check_digits(test_random() >> (i % 64));
+    }
+    const unsigned int bases[] = {2, 10, 16};
+    for (size_t i = 0; i < sizeof(bases) / sizeof(bases[0]); i++)  {
+        for (size_t j = 0; j < 10000; j++)  {
+            uintmax_t half = test_random() >> (40 + j % 24), n = mirror(half, bases[i], j & 1);
+            palindromes_ok = palindromes_ok && is_palindrome(n, bases[i]);
+            palindromes_ok = palindromes_ok && check_digits(n) && check_digits(n + 1);
+        }
+    }
+    // all 1s in base 2 and all Fs in base 16, but not a palindrome in base 10
+    palindromes_ok = palindromes_ok && is_palindrome(UINTMAX_MAX, 2) && is_palindrome(UINTMAX_MAX, 16);
+    palindromes_ok = palindromes_ok && !is_palindrome(UINTMAX_MAX, 10) && is_palindrome(0, 10);
+    printf("digits small %d\n", small_ok);
+    printf("digits edges %d\n", edges_ok);
+    printf("digits random %d\n", random_ok);
+    printf("digits palindromes %d\n", palindromes_ok);
+    return small_ok && edges_ok && random_ok && palindromes_ok;
+}
+
+bool check_odometer(uintmax_t start, uintmax_t stop)    {
+    // runs an odometer with digit_factorials from start to stop, and checks every value and sum it keeps against
+    // digit_sum() and digit_factorial_sum(), then checks that a plain odometer over the same range keeps no table_sum
+    digit_odometer od = digit_odometer3(start, stop, digit_factorials), plain = digit_odometer2(start, stop);
+    bool ok = true;
+    for (uintmax_t n = start; n < stop; n++)    {
+        ok = ok && !od.exhausted && next(od) == n && od.digit_sum == digit_sum(n);
+        ok = ok && od.table_sum == digit_factorial_sum(n);
+        ok = ok && !plain.exhausted && next(plain) == n && plain.digit_sum == digit_sum(n) && !plain.table_sum;
+    }
+    return ok && od.exhausted && plain.exhausted;
+}
+
+bool test_odometer()    {
+    // prints whether the odometer kept up with digit_sum() and digit_factorial_sum() from 0 to a million, across the
+    // carry into every digit position up to the 20th, below UINTMAX_MAX, and from random starts
+    bool small_ok = check_odometer(0, 1000000), carries_ok = true, random_ok = true;
+    for (uintmax_t power = 10; power; power = (power <= UINTMAX_MAX / 10) ? power * 10 : 0) {
+        // 10^k - 1 carries through every digit at once, and 2 * 10^k - 1 through all but the leading one
+        carries_ok = carries_ok && check_odometer(power - min(power, 50), power + 50);
+        if (power < UINTMAX_MAX / 4)    {
+            carries_ok = carries_ok && check_odometer(power * 2 - min(power, 50), power * 2 + 50);
+        }
+    }
+    carries_ok = carries_ok && check_odometer(UINTMAX_MAX - 1000, UINTMAX_MAX) && check_odometer(5, 5);
+    carries_ok = carries_ok && check_odometer(7, 3) && check_odometer(9, 10);
+    for (size_t i = 0; i < 10000; i++)  {
+        uintmax_t start = test_random() >> (i % 64);
+        random_ok = random_ok && check_odometer(start, start + min(UINTMAX_MAX - start, 100));
+    }
+    printf("odometer small %d\n", small_ok);
+    printf("odometer carries %d\n", carries_ok);
+    printf("odometer random %d\n", random_ok);
+    return small_ok && carries_ok && random_ok;
+}
+
+int main(int argc, char const *argv[]) {
+    // each line ends in 1 if that check passed, or 0 if it failed
+    bool ok = test_digits();
+    ok = test_odometer() && ok;
+    return !ok;
+}
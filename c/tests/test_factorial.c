@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include "../include/factorial.h"
+
+#define EXACT_LIMIT 2000
+
+const char *F100 = "9332621544394415268169923885626670049071596826438162146859296389521759999322991560894146397615"
+                   "6518286253697920827223758251185210916864000000000000000000000000";
+
+bool test_factorial_bigint()    {
+    // prints whether factorial_bigint() gives the known 100!, whether it agrees with a running product up to
+    // EXACT_LIMIT, and whether 10000! has its known 35660 digits, 2499 of them trailing zeros
+    BCD_int expected = BCD_from_ascii(F100, strlen(F100), false), got;
+    bigint exact = factorial_bigint(100);
+    got = bcd_from_bigint(exact);
+    bool known_ok = !cmp_bcd(got, expected);
+    free_BCD_int(expected);
+    free_BCD_int(got);
+    free_bigint(exact);
+    printf("factorial_bigint 100 %d\n", known_ok);
+
+    bool product_ok = true;
+    bigint product = new_bigint(1, false), factor, tmp;
+    for (uintmax_t n = 0; n <= EXACT_LIMIT; n++)    {
+        if (n)  {
+            factor = new_bigint(n, false);
+            tmp = mul_bigint(product, factor);
+            free_bigint(product);
+            free_bigint(factor);
+            product = tmp;
+        }
+        // each call sieves, so check every n near MAX_FACTORIAL_64 and then a spread
+        if (n < 100 || n % 37 == 0 || n == EXACT_LIMIT) {
+            exact = factorial_bigint(n);
+            product_ok = product_ok && !cmp_bigint(exact, product);
+            free_bigint(exact);
+        }
+    }
+    free_bigint(product);
+    printf("factorial_bigint product %d\n", product_ok);
+
+    exact = factorial_bigint(10000);
+    got = bcd_from_bigint(exact);
+    expected = new_BCD_int(10, false);
+    BCD_int shifted = div_bcd_pow_10(got, 2499), back = mul_bcd_pow_10(shifted, 2499);
+    BCD_int last = mod_bcd(shifted, expected);
+    bool digits_ok = got.decimal_digits == 35660 && !cmp_bcd(back, got) && !last.zero;
+    free_BCD_int(got);
+    free_BCD_int(shifted);
+    free_BCD_int(back);
+    free_BCD_int(last);
+    free_BCD_int(expected);
+    free_bigint(exact);
+    printf("factorial_bigint 10000 %d\n", digits_ok);
+    return known_ok && product_ok && digits_ok;
+}
+
+bool test_factorial_mod()   {
+    // prints m and whether factorial_mod() agrees with a running product mod m for every n up to m + 1, which takes
+    // the Wilson's theorem branch for prime m once n is past m / 2
+    const uint64_t moduli[] = {1, 2, 3, 4, 5, 7, 10, 97, 561, 1000, 1009, 4096, 10007};
+    bool all_ok = true;
+    for (size_t i = 0; i < sizeof(moduli) / sizeof(moduli[0]); i++) {
+        uint64_t m = moduli[i], product = 1 % m;
+        bool ok = true;
+        for (uintmax_t n = 0; n <= m + 1; n++)  {
+            product = n ? mul_mod(product, n % m, m) : product;
+            ok = ok && factorial_mod(n, m) == product;
+        }
+        printf("factorial_mod %llu %d\n", (unsigned long long) m, ok);
+        all_ok = all_ok && ok;
+    }
+    // for big primes only the Wilson branch is feasible: (p - 1)! = -1, (p - 2)! = 1, and (p - 3)! = 1 / (p - 2),
+    // which is -1/2, or (p - 1) / 2
+    const uint64_t primes[] = {2305843009213693951ULL, 18446744073709551557ULL, 1000000007};
+    bool wilson_ok = true;
+    for (size_t i = 0; i < sizeof(primes) / sizeof(primes[0]); i++) {
+        uint64_t p = primes[i];
+        wilson_ok = wilson_ok && factorial_mod(p - 1, p) == p - 1 && factorial_mod(p - 2, p) == 1;
+        wilson_ok = wilson_ok && factorial_mod(p - 3, p) == (p - 1) / 2 && factorial_mod(p, p) == 0;
+        // and from (p - 3)! down to (p - 1000)!, each step divides by the factor it drops
+        uint64_t term = factorial_mod(p - 3, p);
+        for (uint64_t n = p - 3; n > p - 1000; n--) {
+            uint64_t lower = factorial_mod(n - 1, p);
+            wilson_ok = wilson_ok && mul_mod(lower, n, p) == term;
+            term = lower;
+        }
+    }
+    printf("factorial_mod wilson %d\n", wilson_ok);
+    return all_ok && wilson_ok;
+}
+
+int main(int argc, char const *argv[]) {
+    // each line ends in 1 if that check passed, or 0 if it failed
+    bool ok = test_factorial_bigint();
+    ok = test_factorial_mod() && ok;
+    return !ok;
+}
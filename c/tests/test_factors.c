@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include "../include/factors.h"
+
+#define FACTORS_LIMIT 10000
+
+int main(int argc, char const *argv[]) {
+    // prints the check and whether it matched trial division for every n below FACTORS_LIMIT. Each line ends in 1 if
+    // that check passed, or 0 if it failed
+    bool list_ok = true, iterator_ok = true, sigma_ok = true, table_ok = true;
+    uintmax_t *expected = (uintmax_t *) malloc(FACTORS_LIMIT * sizeof(uintmax_t)), *tables[4];
+    spf_table spf = spf_table3(FACTORS_LIMIT, false, false);
+    for (unsigned char k = 0; k < 4; k++)   {
+        tables[k] = divisor_sigma_table(&spf, k);
+    }
+    for (uintmax_t n = 1; n < FACTORS_LIMIT; n++)   {
+        size_t len = 0, got_len;
+        uintmax_t sigmas[4] = {0, 0, 0, 0};
+        for (uintmax_t d = 1; d <= n; d++)  {
+            if (n % d == 0) {
+                expected[len++] = d;
+                uintmax_t power = 1;
+                for (unsigned char k = 0; k < 4; k++, power *= d)  {
+                    sigmas[k] += power;
+                }
+            }
+        }
+        uintmax_t *got = divisor_list(n, &got_len);
+        list_ok = list_ok && got_len == len && !memcmp(got, expected, len * sizeof(uintmax_t));
+        free(got);
+        // proper_divisors() owns a list like the one above, so it needs freeing even once it's exhausted
+        factor_counter fc = proper_divisors(n);
+        for (size_t i = 0; i < len; i++)    {
+            iterator_ok = iterator_ok && !fc.exhausted && next(fc) == expected[i];
+        }
+        iterator_ok = iterator_ok && fc.exhausted && proper_divisor_count(n) == len;
+        free_factor_counter(fc);
+        for (unsigned char k = 0; k < 4; k++)   {
+            sigma_ok = sigma_ok && divisor_sigma(n, k) == sigmas[k];
+            table_ok = table_ok && tables[k][n] == sigmas[k];
+        }
+        sigma_ok = sigma_ok && divisor_count(n) == len;
+    }
+    for (unsigned char k = 0; k < 4; k++)   {
+        table_ok = table_ok && !tables[k][0];
+        free(tables[k]);
+    }
+    free_spf_table(spf);
+    free(expected);
+    printf("divisor_list %d\n", list_ok);
+    printf("proper_divisors %d\n", iterator_ok);
+    printf("divisor_sigma %d\n", sigma_ok);
+    printf("divisor_sigma_table %d\n", table_ok);
+    return !(list_ok && iterator_ok && sigma_ok && table_ok);
+}
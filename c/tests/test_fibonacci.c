@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include "../include/fibonacci.h"
+
+#define PISANO_LIMIT 1000
+#define BCD_TERMS 3000
+
+const char *F1000 = "43466557686937456435688527675040625802564660517371780402481729089536555417949051890403879840079255169295922"
+                    "593080322634775209689623239873322471161642996440906533187938298969649928516003704476137795166849228875";
+
+uint64_t add_mod_u64(uint64_t a, uint64_t b, uint64_t m)  {
+    // a + b mod m for a, b < m, without overflowing even when m is past 2^63
+    return (a >= m - b) ? a - (m - b) : a + b;
+}
+
+bool test_pisano_period()   {
+    // prints whether pisano_period() agrees with walking the sequence mod m until (0, 1) comes back, for every m up to
+    // PISANO_LIMIT, and whether fibonacci_mod() agrees with that same walk at every step
+    bool period_ok = true, mod_ok = true;
+    for (uint64_t m = 1; m <= PISANO_LIMIT; m++)    {
+        uint64_t a = 0, b = 1 % m, tmp;
+        uintmax_t period = 0;
+        do  {
+            mod_ok = mod_ok && fibonacci_mod(period, m) == a;
+            tmp = add_mod_u64(a, b, m);
+            a = b;
+            b = tmp;
+            period++;
+        } while (a != 0 || b != 1 % m);
+        period_ok = period_ok && pisano_period(m) == period;
+    }
+    printf("pisano %d\n", period_ok);
+    printf("fibonacci_mod small %d\n", mod_ok);
+    return period_ok && mod_ok;
+}
+
+bool test_fibonacci_mod_large() {
+    // prints whether fibonacci_mod() agrees with walking the sequence for moduli near 2^64, where the sums overflow,
+    // and whether huge indices agree with the index reduced by the Pisano period
+    const uint64_t moduli[] = {UINT64_MAX, UINT64_MAX - 58, (uint64_t) 1 << 63, ((uint64_t) 1 << 63) + 1, 1000000007};
+    bool walk_ok = true, period_ok = true;
+    for (size_t i = 0; i < sizeof(moduli) / sizeof(moduli[0]); i++) {
+        uint64_t m = moduli[i], a = 0, b = 1, tmp;
+        for (uintmax_t n = 0; n < 2000; n++) {
+            walk_ok = walk_ok && fibonacci_mod(n, m) == a;
+            tmp = add_mod_u64(a, b, m);
+            a = b;
+            b = tmp;
+        }
+    }
+    const uint64_t small_moduli[] = {2, 10, 1000, 999983, 1000000007, 3 * 5 * 7 * 11 * 13 * 17 * 19};
+    for (size_t i = 0; i < sizeof(small_moduli) / sizeof(small_moduli[0]); i++)   {
+        uint64_t m = small_moduli[i];
+        uintmax_t period = pisano_period(m), n = 1000000000000000003ULL;
+        period_ok = period_ok && fibonacci_mod(n, m) == fibonacci_mod(n % period, m);
+        period_ok = period_ok && fibonacci_mod(period, m) == 0 && fibonacci_mod(period + 1, m) == 1 % m;
+    }
+    printf("fibonacci_mod large %d\n", walk_ok);
+    printf("fibonacci_mod period %d\n", period_ok);
+    return walk_ok && period_ok;
+}
+
+bool test_fibonacci_exact() {
+    // prints whether fibonacci_bigint() gives the known F(1000), and whether fibonacci_bcd0() yields the same terms as
+    // fibonacci_bigint() over the first BCD_TERMS of them
+    BCD_int expected = BCD_from_ascii(F1000, strlen(F1000), false), got;
+    bigint f = fibonacci_bigint(1000);
+    got = bcd_from_bigint(f);
+    bool known_ok = !cmp_bcd(got, expected);
+    free_BCD_int(expected);
+    free_BCD_int(got);
+    free_bigint(f);
+    printf("fibonacci_bigint 1000 %d\n", known_ok);
+
+    bool iterator_ok = true;
+    fibonacci_bcd fib = fibonacci_bcd0();
+    for (uintmax_t n = 1; n <= BCD_TERMS; n++)    {
+        const BCD_int *term = next(fib);
+        iterator_ok = iterator_ok && fib.idx == n;
+        // converting every term would dominate the run time, so check all the short ones and then a spread
+        if (n < 100 || n % 97 == 0 || n == BCD_TERMS)  {
+            f = fibonacci_bigint(n);
+            got = bcd_from_bigint(f);
+            iterator_ok = iterator_ok && !cmp_bcd(*term, got);
+            free_BCD_int(got);
+            free_bigint(f);
+        }
+    }
+    free_fibonacci_bcd(fib);
+    printf("fibonacci_bcd %d\n", iterator_ok);
+    return known_ok && iterator_ok;
+}
+
+int main(int argc, char const *argv[]) {
+    // each line ends in 1 if that check passed, or 0 if it failed
+    bool ok = test_pisano_period();
+    ok = test_fibonacci_mod_large() && ok;
+    ok = test_fibonacci_exact() && ok;
+    return !ok;
+}
@@ -5,10 +5,21 @@
 #define MAX_PRIME 1000
 #endif
 
+#ifndef MIN_PRIME
+#define MIN_PRIME 0
+#endif
+
 int main(int argc, char const *argv[]) {
     // prints number, is_prime(), is_composite(), prime index or -1
-    prime_counter pc = prime_counter1(MAX_PRIME);
     uintmax_t i, p, prev = 0;
+    if (MIN_PRIME)  {
+        // prime indices are unknown this far out, so every line gets -1
+        for (i = MIN_PRIME; i < MAX_PRIME; i++) {
+            printf("%" PRIuMAX " %d %" PRIuMAX " -1\n", i, is_prime(i), is_composite(i));
+        }
+        return 0;
+    }
+    prime_counter pc = prime_counter1(MAX_PRIME);
     p = next(pc);
     while (!pc.exhausted) {
         for (i = prev + 1; i < p; i++)  {
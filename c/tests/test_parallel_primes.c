@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include "../include/parallel_primes.h"
+
+#define UNIT PARALLEL_SIEVE_UNIT_SPAN
+
+int main(int argc, char const *argv[]) {
+    // prints threads, lo, hi, then 1 or 0 for whether the count, the sum, and the sieve agree with prime_sieve
+    const uintmax_t ranges[][2] = {
+        {0, 2}, {0, 3}, {2, 3}, {3, 3}, {10, 5}, {0, 1000},
+        {1, UNIT + 1}, {UNIT - 3, UNIT + 3}, {UNIT - 1, 3 * UNIT + 5}, {2 * UNIT, 2 * UNIT + 1},
+        {12345, 2 * UNIT - 12345}, {UNIT / 2 + 1, 3 * UNIT}
+    };
+    const unsigned thread_counts[] = {1, 2, 5, 0};
+    bool all_ok = true;
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++)  {
+        unsigned threads = thread_counts[t] ? thread_counts[t] : parallel_sieve_threads();
+        for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+            uintmax_t lo = ranges[i][0], hi = ranges[i][1], count = 0, p;
+            prime_sum_t sum = 0;
+            bool sieve_ok = true;
+            prime_sieve ps = prime_sieve0();
+            parallel_prime_sieve pps = parallel_prime_sieve3(lo, hi, threads);
+            for (p = next(ps); p < hi; p = next(ps))    {
+                if (p >= lo)    {
+                    count++;
+                    sum += p;
+                    sieve_ok = sieve_ok && !pps.exhausted && next(pps) == p;
+                }
+            }
+            sieve_ok = sieve_ok && (pps.exhausted || !next(pps)) && pps.exhausted;
+            free_prime_sieve(ps);
+            free_parallel_prime_sieve(pps);
+            bool count_ok = (parallel_prime_count(lo, hi, threads) == count);
+            bool sum_ok = (parallel_prime_sum(lo, hi, threads) == sum);
+            printf("%u %" PRIuMAX " %" PRIuMAX " %d %d %d\n", threads, lo, hi, count_ok, sum_ok, sieve_ok);
+            all_ok = all_ok && count_ok && sum_ok && sieve_ok;
+        }
+        // stopping early has to shut the workers down cleanly
+        parallel_prime_sieve pps = parallel_prime_sieve3(0, 3 * UNIT, threads);
+        bool early_ok = (next(pps) == 2 && next(pps) == 3 && next(pps) == 5);
+        free_parallel_prime_sieve(pps);
+        printf("%u early stop %d\n", threads, early_ok);
+        all_ok = all_ok && early_ok;
+    }
+    return !all_ok;
+}
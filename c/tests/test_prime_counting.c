@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include "../include/prime_counting.h"
+
+#define SWEEP_LIMIT 1000
+#define SQUARES_LIMIT 300
+
+const uintmax_t pi_powers_of_10[] = {
+    0, 4, 25, 168, 1229, 9592, 78498, 664579, 5761455, 50847534, 455052511, 4118054813ULL, 37607912018ULL
+};
+const uintmax_t sum_powers_of_10[] = {
+    0, 17, 1060, 76127, 5736396, 454396537, 37550402023ULL, 3203324994356ULL, 279209790387276ULL,
+    24739512092254535ULL, 2220822432581729238ULL
+};
+
+bool test_known_values()    {
+    // prints k and whether prime_pi(10^k) and prime_sum(10^k) match their known values
+    bool all_ok = true;
+    uintmax_t x = 1;
+    for (size_t k = 0; k < sizeof(pi_powers_of_10) / sizeof(pi_powers_of_10[0]); k++, x *= 10)   {
+        bool ok = prime_pi(x) == pi_powers_of_10[k];
+        if (k < sizeof(sum_powers_of_10) / sizeof(sum_powers_of_10[0]))  {
+            ok = ok && prime_sum(x) == sum_powers_of_10[k];
+        }
+#if HAS_INT128
+        // this is the first power of 10 whose sum doesn't fit in 64 bits
+        if (k == 11)    {
+            ok = ok && prime_sum(x) == (prime_sum_t) 201467077743ULL * 1000000000ULL + 744681014ULL;
+        }
+#endif
+        printf("known %zu %d\n", k, ok);
+        all_ok = all_ok && ok;
+    }
+    return all_ok;
+}
+
+bool test_sweep()   {
+    // prints whether prime_pi() and prime_sum() agree with a sieve for every x up to SWEEP_LIMIT, and for x next to
+    // p^2 for every prime p up to SQUARES_LIMIT, which is where another prime starts sifting and the roughs get cut.
+    // Each call starts its own prime_sieve, so the limits are kept small
+    uintmax_t count = 0, p, limit = SQUARES_LIMIT * SQUARES_LIMIT + 2;
+    prime_sum_t sum = 0;
+    uintmax_t *counts = (uintmax_t *) malloc(sizeof(uintmax_t) * (limit + 1));
+    prime_sum_t *sums = (prime_sum_t *) malloc(sizeof(prime_sum_t) * (limit + 1));
+    prime_sieve ps = prime_sieve0();
+    p = next(ps);
+    for (uintmax_t x = 0; x <= limit; x++)  {
+        if (x == p) {
+            count++;
+            sum += p;
+            p = next(ps);
+        }
+        counts[x] = count;
+        sums[x] = sum;
+    }
+    free_prime_sieve(ps);
+    bool sweep_ok = true, squares_ok = true;
+    for (uintmax_t x = 0; x <= SWEEP_LIMIT; x++)    {
+        sweep_ok = sweep_ok && prime_pi(x) == counts[x] && prime_sum(x) == sums[x];
+    }
+    ps = prime_sieve0();
+    for (p = next(ps); p <= SQUARES_LIMIT; p = next(ps))    {
+        for (uintmax_t x = p * p - 2; x <= p * p + 2; x++)  {
+            squares_ok = squares_ok && prime_pi(x) == counts[x] && prime_sum(x) == sums[x];
+        }
+    }
+    free_prime_sieve(ps);
+    free(counts);
+    free(sums);
+    printf("sweep %d\n", sweep_ok);
+    printf("squares %d\n", squares_ok);
+    return sweep_ok && squares_ok;
+}
+
+int main(int argc, char const *argv[]) {
+    // each line ends in 1 if that check passed, or 0 if it failed
+    bool ok = test_known_values();
+    ok = test_sweep() && ok;
+    return !ok;
+}